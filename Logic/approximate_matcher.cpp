@@ -0,0 +1,347 @@
+#include "approximate_matcher.h"
+#include "thompsons_construction.h"
+#include "bit_ops.h"
+
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+/*
+Glushkov construction
+Every symbol or class leaf is a position 1..m (position 0 is the initial
+state). Bottom-up over the tree: nullable, first and last sets, and the
+follow set of each position:
+- a.b: follow(last(a)) += first(b)
+- a*:  follow(last(a)) += first(a)
+follow(0) = first(root); the final set is last(root), plus 0 if the
+regex matches ε. Sets are multi-word bitsets, so the DFA engine is not
+limited to 63 positions.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = 0;
+
+using Bits = vector<uint64_t>;
+
+void or_into(Bits& into, const Bits& from) {
+    for (size_t w = 0; w < into.size(); ++w) into[w] |= from[w];
+}
+
+struct Glushkov {
+    size_t positions = 0;
+    size_t words = 1;
+    vector<Bits> follow;          // per position 0..m
+    vector<Bits> symbols;         // per byte: positions whose leaf accepts it
+    Bits final;
+
+    Bits empty() const { return Bits(words, 0); }
+
+    Bits follow_of(const uint64_t* set) const {
+        Bits result = empty();
+        for (size_t w = 0; w < words; ++w) {
+            for (uint64_t bits = set[w]; bits; bits &= bits - 1) {
+                or_into(result, follow[w * 64 + lowest_bit(bits)]);
+            }
+        }
+        return result;
+    }
+};
+
+struct Sets {
+    bool nullable;
+    Bits first;
+    Bits last;
+};
+
+class GlushkovBuilder {
+public:
+    explicit GlushkovBuilder(Glushkov& g) : g(g) {}
+
+    size_t count_positions(const TreeNode* node) const {
+        if (!node) return 0;
+        if (node->value == '|' || node->value == '.') {
+            vector<const TreeNode*> operands;
+            flatten_chain(node, node->value, operands);
+            size_t total = 0;
+            for (const TreeNode* operand : operands) total += count_positions(operand);
+            return total;
+        }
+        if (node->value == '*') return count_positions(node->left);
+        return node->value == EPSILON ? 0 : 1;
+    }
+
+    Sets build(const TreeNode* node) {
+        if (node->value == '|' || node->value == '.') {
+            vector<const TreeNode*> operands;
+            flatten_chain(node, node->value, operands);
+            Sets result = build(operands[0]);
+            for (size_t i = 1; i < operands.size(); ++i) {
+                Sets next = build(operands[i]);
+                if (node->value == '|') {
+                    result.nullable = result.nullable || next.nullable;
+                    or_into(result.first, next.first);
+                    or_into(result.last, next.last);
+                    continue;
+                }
+                add_follow(result.last, next.first);
+                if (result.nullable) or_into(result.first, next.first);
+                if (next.nullable) {
+                    or_into(next.last, result.last);
+                }
+                result.last = move(next.last);
+                result.nullable = result.nullable && next.nullable;
+            }
+            return result;
+        }
+        if (node->value == '*') {
+            Sets inner = build(node->left);
+            add_follow(inner.last, inner.first);
+            inner.nullable = true;
+            return inner;
+        }
+        if (node->value == EPSILON) return {true, g.empty(), g.empty()};
+
+        size_t p = ++next_position;
+        Bits self = g.empty();
+        self[p / 64] |= uint64_t{1} << (p % 64);
+        auto add_byte = [&](unsigned char byte) { g.symbols[byte][p / 64] |= uint64_t{1} << (p % 64); };
+        if (node->value == CHAR_CLASS) {
+            vector<char> bytes;
+            expand_char_class(*node->char_class, bytes);
+            for (char byte : bytes) add_byte(static_cast<unsigned char>(byte));
+        } else {
+            add_byte(static_cast<unsigned char>(node->value));
+        }
+        return {false, self, self};
+    }
+
+private:
+    Glushkov& g;
+    size_t next_position = 0;
+
+    void add_follow(const Bits& from, const Bits& to) {
+        for (size_t w = 0; w < g.words; ++w) {
+            for (uint64_t bits = from[w]; bits; bits &= bits - 1) {
+                or_into(g.follow[w * 64 + lowest_bit(bits)], to);
+            }
+        }
+    }
+};
+
+/*
+One step of the error rows for the DFA builder (same recurrence as the
+bit-parallel scanner, on multi-word rows). Row i also absorbs row i - 1:
+"at most i errors" includes "at most i - 1", which keeps states canonical.
+*/
+void step_rows(const Glushkov& g, unsigned errors, bool unanchored,
+               const Bits& rows, const Bits& symbols, Bits& next) {
+    const size_t W = g.words;
+    next.assign(rows.size(), 0);
+    for (unsigned i = 0; i <= errors; ++i) {
+        Bits moved = g.follow_of(&rows[i * W]);
+        for (size_t w = 0; w < W; ++w) next[i * W + w] = moved[w] & symbols[w];
+        if (i == 0) {
+            if (unanchored) next[0] |= 1;
+            continue;
+        }
+        Bits substituted = g.follow_of(&rows[(i - 1) * W]);
+        Bits deleted = g.follow_of(&next[(i - 1) * W]);
+        for (size_t w = 0; w < W; ++w) {
+            next[i * W + w] |= rows[(i - 1) * W + w] | substituted[w] | deleted[w] | next[(i - 1) * W + w];
+        }
+    }
+}
+
+bool rows_accept(const Glushkov& g, unsigned errors, const Bits& rows) {
+    for (size_t w = 0; w < g.words; ++w) {
+        if (rows[errors * g.words + w] & g.final[w]) return true;
+    }
+    return false;
+}
+
+struct RowsHash {
+    size_t operator()(const Bits& rows) const {
+        uint64_t h = rows.size();
+        for (uint64_t x : rows) {
+            h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+} // namespace
+
+bool ApproximateMatcher::build(const TreeNode* root, unsigned max_errors, bool unanchored,
+                               ApproximateEngine engine, size_t max_dfa_states) {
+    *this = ApproximateMatcher();
+    errors = max_errors;
+    is_unanchored = unanchored;
+
+    // Glushkov automaton (an empty tree has no words: leave every set empty)
+    Glushkov g;
+    GlushkovBuilder builder(g);
+    g.positions = builder.count_positions(root);
+    g.words = g.positions / 64 + 1;
+    g.follow.assign(g.positions + 1, g.empty());
+    g.symbols.assign(256, g.empty());
+    g.final = g.empty();
+    if (root) {
+        Sets sets = builder.build(root);
+        g.follow[0] = sets.first;
+        g.final = sets.last;
+        if (sets.nullable) g.final[0] |= 1;
+    }
+    positions = g.positions;
+
+    // Rows before any input: i deletions from the initial state
+    const size_t W = g.words;
+    Bits rows(W * (errors + 1), 0);
+    rows[0] = 1;
+    for (unsigned i = 1; i <= errors; ++i) {
+        Bits deleted = g.follow_of(&rows[(i - 1) * W]);
+        for (size_t w = 0; w < W; ++w) rows[i * W + w] = rows[(i - 1) * W + w] | deleted[w];
+    }
+
+    // DFA engine: subset construction over row tuples, byte classes by symbol mask
+    if (engine != ApproximateEngine::BIT_PARALLEL) {
+        map<Bits, uint8_t> class_of_mask;
+        vector<int> representative;
+        for (int byte = 0; byte < 256; ++byte) {
+            auto [it, inserted] = class_of_mask.emplace(g.symbols[byte], static_cast<uint8_t>(class_of_mask.size()));
+            if (inserted) representative.push_back(byte);
+            byte_class[byte] = it->second;
+        }
+        num_classes = static_cast<uint32_t>(representative.size());
+
+        unordered_map<Bits, uint32_t, RowsHash> ids;
+        vector<Bits> states{Bits(rows.size(), 0)};   // dead: every row empty
+        ids.emplace(states[0], DEAD);
+        transitions.assign(num_classes, DEAD);
+        accepting.assign(1, 0);
+        auto add_state = [&](const Bits& key) {
+            auto [it, inserted] = ids.emplace(key, static_cast<uint32_t>(states.size()));
+            if (inserted) {
+                states.push_back(key);
+                accepting.push_back(rows_accept(g, errors, key) ? 1 : 0);
+                transitions.resize(transitions.size() + num_classes, DEAD);
+            }
+            return it->second;
+        };
+
+        start = add_state(rows);
+        Bits next;
+        bool fits = true;
+        for (size_t s = 1; s < states.size() && fits; ++s) {
+            for (uint32_t c = 0; c < num_classes; ++c) {
+                step_rows(g, errors, unanchored, states[s], g.symbols[representative[c]], next);
+                transitions[s * num_classes + c] = add_state(next);
+            }
+            fits = states.size() <= max_dfa_states;
+        }
+        if (fits) {
+            used_engine = ApproximateEngine::DFA;
+            return true;
+        }
+        transitions.clear();
+        accepting.clear();
+        if (engine == ApproximateEngine::DFA) return false;
+    }
+
+    // Bit-parallel engine
+    if (g.positions > MAX_BIT_PARALLEL_POSITIONS) return false;
+    for (int byte = 0; byte < 256; ++byte) symbol_mask[byte] = g.symbols[byte][0];
+    for (size_t chunk = 0; chunk < 8; ++chunk) {
+        for (size_t value = 0; value < 256; ++value) {
+            Row set = 0;
+            for (size_t bit = 0; bit < 8; ++bit) {
+                size_t p = chunk * 8 + bit;
+                if ((value >> bit) & 1 && p <= g.positions) set |= g.follow[p][0];
+            }
+            follow_table[chunk][value] = set;
+        }
+    }
+    final_mask = g.final[0];
+    initial_rows = rows;
+    used_engine = ApproximateEngine::BIT_PARALLEL;
+    return true;
+}
+
+ApproximateMatcher::Row ApproximateMatcher::follow(Row rows) const {
+    Row result = 0;
+    for (size_t chunk = 0; chunk < 8 && rows; ++chunk, rows >>= 8) {
+        result |= follow_table[chunk][rows & 0xff];
+    }
+    return result;
+}
+
+void ApproximateMatcher::step(const Row* rows, unsigned char byte, Row* next) const {
+    const Row symbols = symbol_mask[byte];
+    next[0] = follow(rows[0]) & symbols;
+    if (is_unanchored) next[0] |= 1;
+    for (unsigned i = 1; i <= errors; ++i) {
+        next[i] = (follow(rows[i]) & symbols) | rows[i - 1] | follow(rows[i - 1])
+                | follow(next[i - 1]) | next[i - 1];
+    }
+}
+
+// Calls on_accept(end) for every position where the automaton accepts,
+// stopping when it returns false
+template <typename OnAccept>
+void ApproximateMatcher::scan(string_view input, OnAccept on_accept) const {
+    if (used_engine == ApproximateEngine::DFA) {
+        uint32_t state = start;
+        if (accepting[state] && !on_accept(size_t{0})) return;
+        for (size_t i = 0; i < input.size(); ++i) {
+            state = transitions[static_cast<size_t>(state) * num_classes + byte_class[static_cast<unsigned char>(input[i])]];
+            if (state == DEAD) return;
+            if (accepting[state] && !on_accept(i + 1)) return;
+        }
+        return;
+    }
+    if (used_engine != ApproximateEngine::BIT_PARALLEL) return;
+
+    vector<Row> rows = initial_rows, next(rows.size());
+    if ((rows[errors] & final_mask) && !on_accept(size_t{0})) return;
+    for (size_t i = 0; i < input.size(); ++i) {
+        step(rows.data(), static_cast<unsigned char>(input[i]), next.data());
+        rows.swap(next);
+        if (rows[errors] == 0) return;   // anchored and dead
+        if ((rows[errors] & final_mask) && !on_accept(i + 1)) return;
+    }
+}
+
+bool ApproximateMatcher::matches(string_view input) const {
+    bool at_end = false;
+    scan(input, [&](size_t end) {
+        at_end = end == input.size();
+        return true;
+    });
+    return at_end;
+}
+
+bool ApproximateMatcher::find_first(string_view input, size_t& match_end) const {
+    bool found = false;
+    scan(input, [&](size_t end) {
+        found = true;
+        match_end = end;
+        return false;
+    });
+    return found;
+}
+
+size_t ApproximateMatcher::count_match_ends(string_view input) const {
+    size_t count = 0;
+    scan(input, [&](size_t) {
+        ++count;
+        return true;
+    });
+    return count;
+}
+
+size_t ApproximateMatcher::size_in_bytes() const {
+    size_t bytes = sizeof(*this) + initial_rows.size() * sizeof(Row);
+    if (used_engine == ApproximateEngine::DFA) bytes += transitions.size() * sizeof(uint32_t) + accepting.size();
+    return bytes;
+}
@@ -0,0 +1,91 @@
+#ifndef APPROXIMATE_MATCHER_H
+#define APPROXIMATE_MATCHER_H
+
+#include "parser.h"
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Approximate matching: the input (or a substring of it) matches if it is
+within max_errors insertions, deletions or substitutions of some word of
+the regex (Levenshtein distance).
+
+Both engines run on the Glushkov position automaton of the regex: one
+state per symbol leaf plus an initial state, no ε-edges. Row R_i is the
+set of positions reachable with at most i errors (Wu & Manber 1992,
+extended to regexes by Navarro & Raffinot):
+
+    R'_0 = follow(R_0) & B[c]
+    R'_i = follow(R_i) & B[c]          match
+         | R_{i-1}                     insertion (extra input byte)
+         | follow(R_{i-1})             substitution
+         | follow(R'_{i-1})            deletion (skipped regex symbol)
+
+- BIT_PARALLEL keeps every row in one 64-bit word (up to 63 positions);
+  follow() is eight table lookups, one per byte of the row.
+- DFA determinizes the rows for the fixed error bound: a state is the
+  tuple (R_0 .. R_k), so scanning is one table lookup per byte. The
+  number of states grows quickly with k and the regex, so it is bounded.
+- AUTO takes the DFA if it fits, the bit-parallel scanner otherwise.
+*/
+
+enum class ApproximateEngine {
+    AUTO,
+    BIT_PARALLEL,
+    DFA,
+};
+
+class ApproximateMatcher {
+public:
+    static constexpr size_t MAX_BIT_PARALLEL_POSITIONS = 63;
+
+    // Anchored: the whole input has to match. Unanchored: a match may start
+    // at any position. Returns false if the requested engine does not fit
+    // (too many positions or more than max_dfa_states DFA states).
+    bool build(const TreeNode* root, unsigned max_errors, bool unanchored,
+               ApproximateEngine engine = ApproximateEngine::AUTO, size_t max_dfa_states = 1 << 16);
+
+    // True if the automaton accepts after the whole input (unanchored: the
+    // input ends with an approximate match)
+    bool matches(std::string_view input) const;
+    // End of the first approximate match
+    bool find_first(std::string_view input, size_t& match_end) const;
+    // Number of input positions where some approximate match ends (position 0 included)
+    size_t count_match_ends(std::string_view input) const;
+
+    ApproximateEngine engine() const { return used_engine; }
+    size_t num_positions() const { return positions; }
+    size_t dfa_states() const { return accepting.size(); }
+    size_t size_in_bytes() const;
+
+private:
+    using Row = uint64_t;
+
+    unsigned errors = 0;
+    bool is_unanchored = false;
+    size_t positions = 0;
+    ApproximateEngine used_engine = ApproximateEngine::AUTO;
+
+    // Bit-parallel engine: bit 0 is the initial state, bit p position p
+    std::array<Row, 256> symbol_mask{};               // B[c]
+    std::array<std::array<Row, 256>, 8> follow_table{};
+    Row final_mask = 0;
+    std::vector<Row> initial_rows;
+
+    // DFA engine: state 0 is dead
+    std::array<uint8_t, 256> byte_class{};
+    uint32_t num_classes = 1;
+    uint32_t start = 0;
+    std::vector<uint32_t> transitions;
+    std::vector<uint8_t> accepting;
+
+    Row follow(Row rows) const;
+    void step(const Row* rows, unsigned char byte, Row* next) const;
+    template <typename OnAccept>
+    void scan(std::string_view input, OnAccept on_accept) const;
+};
+
+#endif
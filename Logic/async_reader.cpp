@@ -0,0 +1,404 @@
+#include "async_reader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ASYNC_READER_HAS_POSIX 1
+#else
+#include <fstream>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <cstring>
+#include <deque>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define ASYNC_READER_HAS_IO_URING 1
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t MIN_BUFFER_SIZE = 4 << 10;
+constexpr size_t MAX_BUFFER_SIZE = 1 << 30;   // a read length is 32 bits
+
+class BufferPool {
+public:
+    BufferPool(size_t buffer_size, unsigned count)
+        : memory(new char[buffer_size * count]), buffer_size(buffer_size) {}
+    char* buffer(unsigned i) const { return memory.get() + static_cast<size_t>(i) * buffer_size; }
+    // Leaks the memory: for buffers the kernel may still write into
+    void abandon() { memory.release(); }
+
+private:
+    unique_ptr<char[]> memory;
+    size_t buffer_size;
+};
+
+// Bytes read, 0 at end of input, negative on an error
+using ReadFunction = function<ptrdiff_t(char*, size_t)>;
+
+/*
+Thread backend
+The reader thread fills the buffers round-robin, each as soon as the
+handler has released it; the calling thread hands them over in the same
+order. A buffer holding 0 or a negative count ends both loops.
+*/
+bool read_with_thread(const ReadFunction& read_some, size_t buffer_size, unsigned num_buffers,
+                      const AsyncReader::ChunkHandler& on_chunk) {
+    BufferPool pool(buffer_size, num_buffers);
+    vector<ptrdiff_t> filled(num_buffers, 0);
+    vector<uint8_t> ready(num_buffers, 0);
+    mutex lock;
+    condition_variable changed;
+
+    thread reader([&] {
+        for (unsigned i = 0;; i = (i + 1) % num_buffers) {
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&] { return !ready[i]; });
+            }
+            ptrdiff_t n = read_some(pool.buffer(i), buffer_size);
+            {
+                lock_guard<mutex> guard(lock);
+                filled[i] = n;
+                ready[i] = 1;
+            }
+            changed.notify_all();
+            if (n <= 0) return;
+        }
+    });
+
+    bool ok = true;
+    for (unsigned i = 0;; i = (i + 1) % num_buffers) {
+        ptrdiff_t n;
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return ready[i] != 0; });
+            n = filled[i];
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        on_chunk(string_view(pool.buffer(i), static_cast<size_t>(n)));
+        {
+            lock_guard<mutex> guard(lock);
+            ready[i] = 0;
+        }
+        changed.notify_all();
+    }
+    reader.join();
+    return ok;
+}
+
+#ifdef ASYNC_READER_HAS_IO_URING
+
+// Minimal io_uring: one submitter, one reaper (the same thread)
+class Ring {
+public:
+    Ring() = default;
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    ~Ring() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring) munmap(sq_ring, sq_ring_size);
+        if (fd >= 0) close(fd);
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+        sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+        if (!sq_ring) return false;
+        cq_ring = single_mmap ? sq_ring : map(cq_ring_size, IORING_OFF_CQ_RING);
+        if (!cq_ring) return false;
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+        if (!sqes) return false;
+
+        char* sq = static_cast<char*>(sq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Pins the pool so reads can use READ_FIXED; false if the kernel refuses
+    bool register_buffers(const BufferPool& pool, size_t buffer_size, unsigned count) {
+        vector<iovec> buffers(count);
+        for (unsigned i = 0; i < count; ++i) buffers[i] = {pool.buffer(i), buffer_size};
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers.data(), count) == 0;
+    }
+
+    // Queues a read; buffer_index < 0 reads into an unregistered buffer
+    void prepare_read(int file, uint64_t offset, char* buffer, unsigned length, int buffer_index, uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        unsigned index = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = buffer_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = file;
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        if (buffer_index >= 0) sqe.buf_index = static_cast<uint16_t>(buffer_index);
+        sqe.user_data = user_data;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit;
+    }
+
+    // Submits the queued reads and waits for at least min_complete completions
+    bool enter(unsigned min_complete) {
+        while (true) {
+            long n = syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                             min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, size_t{0});
+            if (n >= 0) {
+                to_submit -= static_cast<unsigned>(n);
+                return true;
+            }
+            if (errno != EINTR) return false;
+        }
+    }
+
+    template <typename OnCompletion>
+    void reap(OnCompletion on_completion) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            on_completion(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sq_ring_size = 0, cq_ring_size = 0, sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned to_submit = 0;
+
+    void* map(size_t size, off_t offset) {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+};
+
+enum class RingStatus { DONE, FAILED, UNAVAILABLE };
+
+/*
+io_uring backend
+Every buffer is a slot; `order` lists the slots in flight in stream order.
+Step 1 - Fill the ring: all slots at consecutive offsets for a regular
+         file, one slot for a stream (offset -1: current position)
+Step 2 - Wait until the front slot completes, reaping whatever else did
+Step 3 - Hand it over. A regular file resubmits the slot for the rest of a
+         short read, or else at the next unread offset; a stream has
+         already submitted its next read into another slot before the
+         handover, so the kernel reads while the handler scans.
+After the end of input or an error the remaining slots are only drained:
+the kernel must be done with the buffers before they are freed. If waiting
+itself fails, it is tried once more (it also resubmits anything still
+queued); if that fails too, the buffers are leaked rather than freed.
+*/
+RingStatus read_with_ring(int fd, size_t buffer_size, unsigned num_buffers, const AsyncReader::ChunkHandler& on_chunk) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) return RingStatus::FAILED;
+    off_t start = S_ISREG(info.st_mode) || S_ISBLK(info.st_mode) ? lseek(fd, 0, SEEK_CUR) : -1;
+    const bool seekable = start >= 0;
+
+    BufferPool pool(buffer_size, num_buffers);   // outlives the ring
+    Ring ring;
+    if (!ring.setup(num_buffers)) return RingStatus::UNAVAILABLE;
+    const bool fixed = ring.register_buffers(pool, buffer_size, num_buffers);
+
+    struct Slot {
+        uint64_t offset;
+        unsigned length;
+        bool done;
+        int result;
+    };
+    vector<Slot> slots(num_buffers);
+    deque<unsigned> order;
+    vector<unsigned> free_slots;
+    for (unsigned s = num_buffers; s-- > 0;) free_slots.push_back(s);
+    uint64_t next_offset = seekable ? static_cast<uint64_t>(start) : 0;
+    uint64_t delivered = 0;
+
+    auto submit = [&](unsigned s, uint64_t offset, unsigned length, bool front) {
+        slots[s] = {offset, length, false, 0};
+        ring.prepare_read(fd, seekable ? offset : UINT64_MAX, pool.buffer(s), length, fixed ? static_cast<int>(s) : -1, s);
+        if (front) {
+            order.push_front(s);
+        } else {
+            order.push_back(s);
+        }
+    };
+    auto submit_next = [&]() {
+        unsigned s = free_slots.back();
+        free_slots.pop_back();
+        submit(s, next_offset, static_cast<unsigned>(buffer_size), false);
+        if (seekable) next_offset += buffer_size;
+    };
+
+    // Step 1
+    for (unsigned i = 0; i < (seekable ? num_buffers : 1u); ++i) submit_next();
+    if (!ring.enter(0)) return RingStatus::UNAVAILABLE;   // a failed enter submits nothing
+
+    bool finished = false, failed = false, unsupported = false;
+    bool wait_failed = false;   // the last wait for a completion failed
+    while (!order.empty()) {
+        // Step 2
+        unsigned s = order.front();
+        if (!slots[s].done) {
+            if (!ring.enter(1)) {
+                if (wait_failed) {
+                    // Cannot wait for the reads in flight; closing the ring does not stop them
+                    pool.abandon();
+                    return RingStatus::FAILED;
+                }
+                wait_failed = finished = failed = true;
+                continue;
+            }
+            wait_failed = false;
+            ring.reap([&](uint64_t slot, int result) {
+                slots[slot].done = true;
+                slots[slot].result = result;
+            });
+            continue;
+        }
+        order.pop_front();
+        Slot slot = slots[s];
+        if (finished) {
+            free_slots.push_back(s);
+            continue;
+        }
+        if (slot.result == -EINTR || slot.result == -EAGAIN) {
+            submit(s, slot.offset, slot.length, true);
+            finished = !ring.enter(0);
+            failed = failed || finished;
+            continue;
+        }
+        if (slot.result <= 0) {
+            // The first read failing with EINVAL means the opcode is not supported
+            unsupported = delivered == 0 && (slot.result == -EINVAL || slot.result == -EOPNOTSUPP);
+            failed = slot.result < 0 && !unsupported;
+            finished = true;
+            free_slots.push_back(s);
+            continue;
+        }
+
+        // Step 3
+        unsigned length = static_cast<unsigned>(slot.result);
+        if (!seekable) {
+            submit_next();
+            if (!ring.enter(0)) finished = failed = true;
+        }
+        on_chunk(string_view(pool.buffer(s), length));
+        delivered += length;
+        if (!seekable) {
+            free_slots.push_back(s);
+        } else if (!finished) {
+            if (length < slot.length) {
+                submit(s, slot.offset + length, slot.length - length, true);
+            } else {
+                submit(s, next_offset, static_cast<unsigned>(buffer_size), false);
+                next_offset += buffer_size;
+            }
+            if (!ring.enter(0)) finished = failed = true;
+        }
+    }
+
+    if (unsupported) return RingStatus::UNAVAILABLE;
+    if (seekable) lseek(fd, start + static_cast<off_t>(delivered), SEEK_SET);   // as if read() had been used
+    return failed ? RingStatus::FAILED : RingStatus::DONE;
+}
+
+#endif
+
+} // namespace
+
+bool AsyncReader::read_fd(int fd, const ChunkHandler& on_chunk) {
+    size_t buffer_size = clamp(options.buffer_size, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+    unsigned num_buffers = max(2u, options.num_buffers);
+#ifdef ASYNC_READER_HAS_IO_URING
+    if (options.backend != ReadBackend::THREAD) {
+        RingStatus status = read_with_ring(fd, buffer_size, num_buffers, on_chunk);
+        if (status != RingStatus::UNAVAILABLE || options.backend == ReadBackend::IO_URING) {
+            used_backend = ReadBackend::IO_URING;
+            return status == RingStatus::DONE;
+        }
+    }
+#endif
+    if (options.backend == ReadBackend::IO_URING) return false;
+    used_backend = ReadBackend::THREAD;
+#ifdef ASYNC_READER_HAS_POSIX
+    auto read_some = [fd](char* out, size_t size) -> ptrdiff_t {
+        while (true) {
+            ssize_t n = read(fd, out, size);
+            if (n >= 0 || errno != EINTR) return n;
+        }
+    };
+    return read_with_thread(read_some, buffer_size, num_buffers, on_chunk);
+#else
+    (void)fd;
+    (void)on_chunk;
+    return false;
+#endif
+}
+
+bool AsyncReader::read_file(const string& path, const ChunkHandler& on_chunk) {
+#ifdef ASYNC_READER_HAS_POSIX
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = read_fd(fd, on_chunk);
+    close(fd);
+    return ok;
+#else
+    ifstream in(path, ios::binary);
+    if (!in || options.backend == ReadBackend::IO_URING) return false;
+    used_backend = ReadBackend::THREAD;
+    auto read_some = [&in](char* out, size_t size) -> ptrdiff_t {
+        in.read(out, static_cast<streamsize>(size));
+        return in.bad() ? -1 : static_cast<ptrdiff_t>(in.gcount());
+    };
+    return read_with_thread(read_some, clamp(options.buffer_size, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE),
+                            max(2u, options.num_buffers), on_chunk);
+#endif
+}
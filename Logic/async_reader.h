@@ -0,0 +1,55 @@
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/*
+Read pipeline that overlaps I/O with scanning
+
+A fixed pool of buffers is kept in flight while the caller's handler
+scans the buffer that completed first in stream order, e.g. by feeding a
+LineStream. Two backends:
+
+- io_uring (Linux, raw syscalls, no liburing): the pool is registered with
+  the ring and read with READ_FIXED (plain READ if registration fails, e.g.
+  under a low RLIMIT_MEMLOCK). Regular files keep every buffer in flight
+  at explicit offsets and completions are reordered; pipes and sockets keep
+  one read in flight, submitted before the previous buffer is handed over.
+- a reader thread filling the same pool, used when io_uring is missing or
+  refused (old kernels, seccomp) or when asked for explicitly.
+*/
+
+enum class ReadBackend { AUTO, IO_URING, THREAD };
+
+struct ReaderOptions {
+    size_t buffer_size = 1 << 20;
+    unsigned num_buffers = 8;
+    ReadBackend backend = ReadBackend::AUTO;
+};
+
+class AsyncReader {
+public:
+    // Called with consecutive, non-empty pieces of the input in order; the
+    // view is only valid during the call
+    using ChunkHandler = std::function<void(std::string_view)>;
+
+    explicit AsyncReader(const ReaderOptions& options = ReaderOptions()) : options(options) {}
+
+    // Reads from the current position of `fd` to end of input. Returns false
+    // on a read error; everything read before it was handed over.
+    bool read_fd(int fd, const ChunkHandler& on_chunk);
+    // Opens and reads a file; returns false if it cannot be opened or read
+    bool read_file(const std::string& path, const ChunkHandler& on_chunk);
+
+    // Backend used by the last read
+    ReadBackend backend() const { return used_backend; }
+
+private:
+    ReaderOptions options;
+    ReadBackend used_backend = ReadBackend::AUTO;
+};
+
+#endif
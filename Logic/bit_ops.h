@@ -0,0 +1,20 @@
+#ifndef BIT_OPS_H
+#define BIT_OPS_H
+
+#include <cstdint>
+
+// Index of the lowest set bit of a non-zero word
+inline int lowest_bit(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "bit_split_matcher.h"
+#include "finite_matcher.h"
+#include "bit_ops.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+/*
+Building one group
+Step 1 - Aho-Corasick: a trie of the group's literals, failure links by
+         breadth-first search, and the complete transition function
+         delta(state, byte); outputs are ORed along the failure links
+Step 2 - for each 2-bit slice j of the byte: subset construction over the
+         Aho-Corasick states, where input value v (0..3) stands for the 64
+         bytes whose bits 2j..2j+1 equal v. The partial match vector of a
+         subset is the OR of the outputs of its states.
+
+A literal ends at the current position if its bit survives the AND of the
+four partial match vectors: each slice of the last |literal| bytes agrees
+with the literal, so all eight bits do.
+*/
+
+namespace {
+
+constexpr size_t WORDS_PER_GROUP = 64;
+constexpr size_t MAX_WORDS_PER_RULE = 1 << 16;
+
+struct SubsetHash {
+    size_t operator()(const vector<uint32_t>& set) const {
+        uint64_t h = set.size();
+        for (uint32_t x : set) {
+            h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+} // namespace
+
+bool BitSplitMatcher::build(const RuleSet& rule_set, vector<RuleError>& errors) {
+    *this = BitSplitMatcher();
+
+    map<string, vector<unsigned>> literals;  // sorted, so groups share prefixes
+    vector<string> words;
+    bool ok = true;
+    for (const Rule& rule : rule_set.rules) {
+        words.clear();
+        if (!enumerate_words(rule.tree.root, words, MAX_WORDS_PER_RULE)) {
+            errors.push_back({rule.line, 0, "not a finite set of literals"});
+            ok = false;
+            continue;
+        }
+        for (string& word : words) {
+            if (word.empty()) {
+                empty_rules.push_back(rule.id);
+            } else {
+                literals[move(word)].push_back(rule.id);
+            }
+        }
+    }
+    if (!ok) {
+        *this = BitSplitMatcher();
+        return false;
+    }
+    sort(empty_rules.begin(), empty_rules.end());
+    empty_rules.erase(unique(empty_rules.begin(), empty_rules.end()), empty_rules.end());
+
+    words.clear();
+    for (auto& [word, rules] : literals) {
+        sort(rules.begin(), rules.end());
+        rules.erase(unique(rules.begin(), rules.end()), rules.end());
+        words.push_back(word);
+        word_rules.push_back(move(rules));
+    }
+    for (size_t begin = 0; begin < words.size(); begin += WORDS_PER_GROUP) {
+        build_group(words, begin, min(words.size(), begin + WORDS_PER_GROUP));
+    }
+    return true;
+}
+
+void BitSplitMatcher::build_group(const vector<string>& words, size_t begin, size_t end) {
+    Group group;
+
+    // Step 1: Aho-Corasick automaton
+    vector<map<unsigned char, uint32_t>> children(1);
+    vector<uint64_t> outputs(1, 0);
+    for (size_t w = begin; w < end; ++w) {
+        uint32_t state = 0;
+        for (unsigned char ch : words[w]) {
+            auto it = children[state].find(ch);
+            if (it == children[state].end()) {
+                it = children[state].emplace(ch, static_cast<uint32_t>(children.size())).first;
+                children.emplace_back();
+                outputs.push_back(0);
+            }
+            state = it->second;
+        }
+        outputs[state] |= uint64_t{1} << (w - begin);
+        group.words.push_back(static_cast<uint32_t>(w));
+    }
+
+    const size_t num_states = children.size();
+    vector<uint32_t> delta(num_states * 256, 0);
+    vector<uint32_t> fail(num_states, 0);
+    vector<uint32_t> order{0};
+    for (const auto& [ch, child] : children[0]) {
+        delta[ch] = child;
+        order.push_back(child);
+    }
+    for (size_t i = 1; i < order.size(); ++i) {
+        uint32_t state = order[i];
+        outputs[state] |= outputs[fail[state]];
+        for (int byte = 0; byte < 256; ++byte) {
+            delta[state * 256 + byte] = delta[fail[state] * 256 + byte];
+        }
+        for (const auto& [ch, child] : children[state]) {
+            fail[child] = delta[fail[state] * 256 + ch];
+            delta[state * 256 + ch] = child;
+            order.push_back(child);
+        }
+    }
+
+    // Step 2: one machine per 2-bit slice
+    for (int j = 0; j < NUM_MACHINES; ++j) {
+        array<vector<int>, 4> bytes_for;
+        for (int byte = 0; byte < 256; ++byte) {
+            bytes_for[(byte >> (2 * j)) & 3].push_back(byte);
+        }
+
+        Machine& machine = group.machines[j];
+        unordered_map<vector<uint32_t>, uint32_t, SubsetHash> ids;
+        vector<vector<uint32_t>> subsets;
+        auto id_of = [&](vector<uint32_t>& subset) {
+            auto [it, inserted] = ids.emplace(subset, static_cast<uint32_t>(subsets.size()));
+            if (inserted) {
+                uint64_t partial = 0;
+                for (uint32_t s : subset) partial |= outputs[s];
+                machine.partial_matches.push_back(partial);
+                subsets.push_back(subset);
+            }
+            return it->second;
+        };
+
+        vector<uint32_t> next{0};
+        id_of(next);
+        for (size_t i = 0; i < subsets.size(); ++i) {
+            for (int v = 0; v < 4; ++v) {
+                next.clear();
+                for (uint32_t s : subsets[i]) {
+                    for (int byte : bytes_for[v]) next.push_back(delta[s * 256 + byte]);
+                }
+                sort(next.begin(), next.end());
+                next.erase(unique(next.begin(), next.end()), next.end());
+                machine.transitions.push_back(id_of(next));
+            }
+        }
+    }
+    groups.push_back(move(group));
+}
+
+void BitSplitMatcher::scan(string_view input, vector<BitSplitMatch>& matches) const {
+    for (unsigned rule : empty_rules) matches.push_back({rule, 0});
+
+    vector<array<uint32_t, NUM_MACHINES>> states(groups.size(), array<uint32_t, NUM_MACHINES>{});
+    vector<unsigned> found;
+    for (size_t i = 0; i < input.size(); ++i) {
+        unsigned byte = static_cast<unsigned char>(input[i]);
+        found.assign(empty_rules.begin(), empty_rules.end());
+        bool any = false;
+        for (size_t g = 0; g < groups.size(); ++g) {
+            const Group& group = groups[g];
+            auto& s = states[g];
+            uint64_t vector_and = ~uint64_t{0};
+            for (int j = 0; j < NUM_MACHINES; ++j) {
+                const Machine& machine = group.machines[j];
+                s[j] = machine.transitions[s[j] * 4 + ((byte >> (2 * j)) & 3)];
+                vector_and &= machine.partial_matches[s[j]];
+            }
+            while (vector_and) {
+                const auto& rules = word_rules[group.words[lowest_bit(vector_and)]];
+                found.insert(found.end(), rules.begin(), rules.end());
+                vector_and &= vector_and - 1;
+                any = true;
+            }
+        }
+        if (any) {
+            sort(found.begin(), found.end());
+            found.erase(unique(found.begin(), found.end()), found.end());
+        }
+        for (unsigned rule : found) matches.push_back({rule, i + 1});
+    }
+}
+
+size_t BitSplitMatcher::size_in_bytes() const {
+    size_t bytes = sizeof(*this) + empty_rules.size() * sizeof(unsigned);
+    for (const Group& group : groups) {
+        bytes += sizeof(group) + group.words.size() * sizeof(uint32_t);
+        for (const Machine& machine : group.machines) {
+            bytes += machine.transitions.size() * sizeof(uint32_t)
+                   + machine.partial_matches.size() * sizeof(uint64_t);
+        }
+    }
+    for (const auto& rules : word_rules) bytes += sizeof(rules) + rules.size() * sizeof(unsigned);
+    return bytes;
+}
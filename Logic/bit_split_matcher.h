@@ -0,0 +1,63 @@
+#ifndef BIT_SPLIT_MATCHER_H
+#define BIT_SPLIT_MATCHER_H
+
+#include "rule_loader.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct BitSplitMatch {
+    unsigned rule_id;
+    size_t end;       // input position just after the match
+};
+
+/*
+Bit-split multi-pattern matcher (Tan & Sherwood, 2005)
+
+Every rule must be a finite set of literals (no '*' over a non-empty
+string). The literals are split into groups of up to 64. For each group an
+Aho-Corasick automaton is built and then projected onto each of the four
+2-bit slices of the input byte, giving four tiny machines with only four
+transitions per state. Every machine state carries a 64-bit partial match
+vector: the literals that can end there given that slice of the input. A
+literal matches exactly when its bit is set in all four vectors.
+
+Per input byte and group: four lookups and three ANDs, whatever the length
+of the literals; the tables need 4 columns instead of 256.
+*/
+class BitSplitMatcher {
+public:
+    // Returns false (with one error per offending rule) if a rule is not a
+    // finite set of literals
+    bool build(const RuleSet& rule_set, std::vector<RuleError>& errors);
+
+    // Every (rule, end) match in input order; each rule at most once per end
+    void scan(std::string_view input, std::vector<BitSplitMatch>& matches) const;
+
+    size_t num_groups() const { return groups.size(); }
+    size_t size_in_bytes() const;
+
+private:
+    static constexpr int NUM_MACHINES = 4;  // 2 bits of the input byte each
+
+    struct Machine {
+        std::vector<uint32_t> transitions;  // state * 4 + 2-bit value
+        std::vector<uint64_t> partial_matches;
+    };
+    struct Group {
+        Machine machines[NUM_MACHINES];
+        std::vector<uint32_t> words;        // bit -> index into word_rules
+    };
+
+    std::vector<Group> groups;
+    // rules matched by each distinct literal
+    std::vector<std::vector<unsigned>> word_rules;
+    // rules that accept ε and therefore match at every position
+    std::vector<unsigned> empty_rules;
+
+    void build_group(const std::vector<std::string>& words, size_t begin, size_t end);
+};
+
+#endif
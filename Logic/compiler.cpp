@@ -0,0 +1,137 @@
+#include "compiler.h"
+#include "thompsons_construction.h"
+#include "nfa2dfa.h"
+#include "dfa_operations.h"
+#include "literal_set.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+using namespace std;
+
+// This file runs the whole regex -> minimized DFA pipeline for library callers.
+// A pure literal alternation (keyword list) skips the pipeline entirely and
+// is built directly as a minimal acyclic DFA (literal_set.cpp).
+// A wide top-level alternation is compiled in parallel:
+// 1. split the branches into groups
+// 2. each group: Thompson's construction -> subset construction -> minimization (one thread per group)
+// 3. merge the group DFAs with a balanced tree of union + minimize steps,
+//    every level of the tree again in parallel
+
+namespace {
+
+// Below this many branches a single subset construction is cheaper than merging
+constexpr size_t MIN_PARALLEL_BRANCHES = 64;
+constexpr size_t MIN_BRANCHES_PER_GROUP = 8;
+constexpr size_t MAX_BRANCHES_PER_GROUP = 256;
+
+// Run body(0..count-1) on up to num_threads threads, the calling thread included
+void parallel_for(size_t count, unsigned num_threads, const function<void(size_t)>& body) {
+    atomic<size_t> next_index{0};
+    auto worker = [&]() {
+        for (size_t i = next_index++; i < count; i = next_index++) {
+            body(i);
+        }
+    };
+
+    vector<thread> workers;
+    size_t extra_threads = min<size_t>(num_threads, count);
+    for (size_t t = 1; t < extra_threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// Thompson's construction for branches[begin] | ... | branches[end - 1]
+NFA build_alternation_nfa(const vector<const TreeNode*>& branches, size_t begin, size_t end) {
+    if (end - begin == 1) {
+        return build_nfa_from_syntax_tree(branches[begin]);
+    }
+
+    NFA nfa;
+    nfa.start_state = create_state();
+    nfa.accept_state = create_state();
+    nfa.accept_state->is_accepting = true;
+
+    for (size_t i = begin; i < end; ++i) {
+        NFA branch = build_nfa_from_syntax_tree(branches[i]);
+        branch.accept_state->is_accepting = false;
+        nfa.start_state->epsilon.push_back(branch.start_state);
+        branch.accept_state->epsilon.push_back(nfa.accept_state);
+    }
+    return nfa;
+}
+
+MinDFA determinize_and_minimize(const NFA& nfa) {
+    set<char> input_symbols = collect_input_symbols(nfa);
+    DFA dfa = nfa_to_dfa(nfa, input_symbols, false);
+    return minimize_dfa(dfa, input_symbols);
+}
+
+} // namespace
+
+MinDFA compile_min_dfa(const TreeNode* root) {
+    if (!root) return MinDFA();
+
+    vector<string> words;
+    if (extract_literal_words(root, words)) {
+        return build_literal_dfa(move(words));
+    }
+    return determinize_and_minimize(build_nfa_from_syntax_tree(root));
+}
+
+MinDFA compile_min_dfa_parallel(const SyntaxTree& tree, unsigned num_threads) {
+    if (!tree.root || tree.root->value != '|') {
+        return compile_min_dfa(tree.root);
+    }
+    vector<string> words;
+    if (extract_literal_words(tree.root, words)) {
+        return build_literal_dfa(move(words));
+    }
+
+    vector<const TreeNode*> branches;
+    flatten_chain(tree.root, '|', branches);
+    if (branches.size() < MIN_PARALLEL_BRANCHES) {
+        return compile_min_dfa(tree.root);
+    }
+
+    if (num_threads == 0) {
+        num_threads = max(1u, thread::hardware_concurrency());
+    }
+
+    // Step 1 - Split branches into groups, a few per thread for load balancing
+    size_t group_size = branches.size() / (static_cast<size_t>(num_threads) * 4);
+    group_size = min(MAX_BRANCHES_PER_GROUP, max(MIN_BRANCHES_PER_GROUP, group_size));
+    size_t num_groups = (branches.size() + group_size - 1) / group_size;
+
+    // Step 2 - Compile and minimize every group
+    vector<MinDFA> level(num_groups);
+    parallel_for(num_groups, num_threads, [&](size_t g) {
+        size_t begin = g * group_size;
+        size_t end = min(branches.size(), begin + group_size);
+        level[g] = determinize_and_minimize(build_alternation_nfa(branches, begin, end));
+    });
+
+    // Step 3 - Balanced merge: union + minimize neighbouring pairs until one DFA is left
+    while (level.size() > 1) {
+        vector<MinDFA> next_level((level.size() + 1) / 2);
+        parallel_for(level.size() / 2, num_threads, [&](size_t i) {
+            const MinDFA& a = level[2 * i];
+            const MinDFA& b = level[2 * i + 1];
+            set<char> input_symbols = collect_input_symbols(a);
+            set<char> b_symbols = collect_input_symbols(b);
+            input_symbols.insert(b_symbols.begin(), b_symbols.end());
+            next_level[i] = minimize_dfa(union_dfa(a, b, input_symbols), input_symbols);
+        });
+        if (level.size() % 2 == 1) {
+            next_level.back() = level.back();
+        }
+        level = move(next_level);
+    }
+    return level[0];
+}
@@ -0,0 +1,20 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "parser.h"
+#include "minimized_dfa.h"
+
+// Whole pipeline for library use: syntax tree -> ε-NFA -> DFA -> minimized DFA
+// (no debug output, unlike the step-by-step run in main)
+
+// Compile on the calling thread
+// (pure literal alternations take the direct minimal-DFA construction)
+MinDFA compile_min_dfa(const TreeNode* root);
+
+// Same result, but a wide top-level alternation (e.g. a blocklist a|b|c|...)
+// is split into branch groups that are compiled and minimized on several
+// threads, then merged pairwise by union + minimize (num_threads = 0 uses
+// the hardware concurrency)
+MinDFA compile_min_dfa_parallel(const SyntaxTree& tree, unsigned num_threads = 0);
+
+#endif
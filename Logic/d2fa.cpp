@@ -0,0 +1,247 @@
+#include "d2fa.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <queue>
+using namespace std;
+
+/*
+Building the D2FA from a flat table
+Step 1 - candidate pairs of states: all pairs for small DFAs; for large ones
+         the neighbours of every state after sorting the rows in a few
+         random column orders (rows that agree on many columns end up close
+         together), which keeps the graph near-linear in size
+Step 2 - edge weight = number of byte classes on which both rows agree;
+         Kruskal's algorithm keeps the maximum-weight spanning forest
+Step 3 - root every tree at its center, so default chains are as short as
+         the tree allows, and walk it breadth-first. A state gets its parent
+         as default unless that would exceed max_default_depth or would not
+         save transitions; otherwise it starts a new chain.
+Step 4 - store, per state, the transitions that differ from its default
+         (or, without a default, those that do not go to the dead state)
+
+The dead state (0) never has a default and stores nothing.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = DFATable::DEAD_STATE;
+constexpr size_t ALL_PAIRS_LIMIT = 2048;
+constexpr int SORT_ROUNDS = 4;
+constexpr size_t NEIGHBOURS = 8;
+
+struct Edge {
+    uint32_t weight;
+    uint32_t u, v;
+};
+
+uint32_t find_root(vector<uint32_t>& parent, uint32_t x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// Breadth-first distances within one tree; returns the farthest node
+uint32_t farthest(const vector<vector<uint32_t>>& tree, uint32_t from,
+                  vector<uint32_t>& distance, vector<uint32_t>& via) {
+    queue<uint32_t> to_visit;
+    distance[from] = 0;
+    via[from] = from;
+    to_visit.push(from);
+    uint32_t last = from;
+    vector<uint32_t> visited;
+    while (!to_visit.empty()) {
+        uint32_t u = to_visit.front();
+        to_visit.pop();
+        visited.push_back(u);
+        last = u;
+        for (uint32_t v : tree[u]) {
+            if (distance[v] == UINT32_MAX) {
+                distance[v] = distance[u] + 1;
+                via[v] = u;
+                to_visit.push(v);
+            }
+        }
+    }
+    for (uint32_t u : visited) distance[u] = UINT32_MAX;
+    return last;
+}
+
+} // namespace
+
+void D2FA::build(const MinDFA& dfa, unsigned max_default_depth) {
+    build(build_dfa_table(dfa), max_default_depth);
+}
+
+void D2FA::build(const DFATable& table, unsigned max_default_depth) {
+    *this = D2FA();
+    const uint32_t n = table.num_states;
+    const uint32_t classes = table.num_classes;
+    auto row = [&](uint32_t s) { return &table.transitions[static_cast<size_t>(s) * classes]; };
+    auto agree = [&](uint32_t u, uint32_t v) {
+        const uint32_t* a = row(u);
+        const uint32_t* b = row(v);
+        uint32_t same = 0;
+        for (uint32_t c = 0; c < classes; ++c) same += a[c] == b[c];
+        return same;
+    };
+
+    // Step 1 & 2: candidate edges with weights
+    vector<Edge> edges;
+    if (n <= ALL_PAIRS_LIMIT) {
+        for (uint32_t u = 1; u < n; ++u) {
+            for (uint32_t v = u + 1; v < n; ++v) {
+                uint32_t weight = agree(u, v);
+                if (weight > 0) edges.push_back({weight, u, v});
+            }
+        }
+    } else {
+        mt19937 rng(12345);
+        vector<uint32_t> columns(classes);
+        iota(columns.begin(), columns.end(), 0);
+        vector<uint32_t> states(n - 1);
+        for (int round = 0; round < SORT_ROUNDS; ++round) {
+            shuffle(columns.begin(), columns.end(), rng);
+            iota(states.begin(), states.end(), 1);
+            sort(states.begin(), states.end(), [&](uint32_t u, uint32_t v) {
+                const uint32_t* a = row(u);
+                const uint32_t* b = row(v);
+                for (uint32_t c : columns) {
+                    if (a[c] != b[c]) return a[c] < b[c];
+                }
+                return u < v;
+            });
+            for (size_t i = 0; i < states.size(); ++i) {
+                for (size_t j = i + 1; j < states.size() && j <= i + NEIGHBOURS; ++j) {
+                    uint32_t weight = agree(states[i], states[j]);
+                    if (weight > 0) edges.push_back({weight, states[i], states[j]});
+                }
+            }
+        }
+    }
+    sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.weight > b.weight; });
+
+    vector<uint32_t> component(n);
+    iota(component.begin(), component.end(), 0);
+    vector<vector<uint32_t>> tree(n);
+    for (const Edge& edge : edges) {
+        uint32_t a = find_root(component, edge.u);
+        uint32_t b = find_root(component, edge.v);
+        if (a == b) continue;
+        component[a] = b;
+        tree[edge.u].push_back(edge.v);
+        tree[edge.v].push_back(edge.u);
+    }
+
+    // Step 3: root each tree at its center, cut long chains
+    vector<uint32_t> non_dead(n, 0);
+    for (uint32_t s = 1; s < n; ++s) {
+        for (uint32_t c = 0; c < classes; ++c) non_dead[s] += row(s)[c] != DEAD;
+    }
+    default_state.assign(n, NO_DEFAULT);
+    vector<uint32_t> depth(n, UINT32_MAX);
+    vector<uint32_t> distance(n, UINT32_MAX), via(n);
+    for (uint32_t s = 1; s < n; ++s) {
+        if (depth[s] != UINT32_MAX) continue;
+
+        // The center is the middle of a longest path (two BFS passes)
+        uint32_t a = farthest(tree, s, distance, via);
+        uint32_t b = farthest(tree, a, distance, via);
+        vector<uint32_t> path{b};
+        while (path.back() != a) path.push_back(via[path.back()]);
+        uint32_t center = path[path.size() / 2];
+
+        queue<uint32_t> to_visit;
+        depth[center] = 0;
+        to_visit.push(center);
+        while (!to_visit.empty()) {
+            uint32_t u = to_visit.front();
+            to_visit.pop();
+            for (uint32_t v : tree[u]) {
+                if (depth[v] != UINT32_MAX) continue;
+                uint32_t differing = classes - agree(u, v);
+                if (depth[u] < max_default_depth && differing < non_dead[v]) {
+                    default_state[v] = u;
+                    depth[v] = depth[u] + 1;
+                    depth_reached = max(depth_reached, depth[v]);
+                } else {
+                    depth[v] = 0;
+                }
+                to_visit.push(v);
+            }
+        }
+    }
+
+    // Step 4: stored transitions
+    start_state = table.start;
+    byte_class = table.byte_class;
+    accepting = table.accepting;
+    state_match_ids = table.match_ids;
+    label_begin.assign(1, 0);
+    for (uint32_t s = 0; s < n; ++s) {
+        if (s != DEAD) {
+            const uint32_t* own = row(s);
+            const uint32_t* base = default_state[s] == NO_DEFAULT ? nullptr : row(default_state[s]);
+            for (uint32_t c = 0; c < classes; ++c) {
+                if (base ? own[c] != base[c] : own[c] != DEAD) {
+                    labels.push_back(static_cast<uint8_t>(c));
+                    targets.push_back(own[c]);
+                }
+            }
+        }
+        label_begin.push_back(static_cast<uint32_t>(labels.size()));
+    }
+}
+
+uint32_t D2FA::next(uint32_t state, unsigned char byte) const {
+    const uint8_t c = byte_class[byte];
+    while (true) {
+        const uint8_t* first = labels.data() + label_begin[state];
+        const uint8_t* last = labels.data() + label_begin[state + 1];
+        const uint8_t* found = lower_bound(first, last, c);
+        if (found != last && *found == c) return targets[found - labels.data()];
+        if (default_state[state] == NO_DEFAULT) return DEAD;
+        state = default_state[state];
+    }
+}
+
+const vector<uint32_t>& D2FA::match_ids(uint32_t state) const {
+    static const vector<uint32_t> none;
+    return state_match_ids.empty() ? none : state_match_ids[state];
+}
+
+bool D2FA::matches(string_view input) const {
+    if (accepting.empty()) return false;
+    uint32_t state = start_state;
+    for (char ch : input) {
+        state = next(state, static_cast<unsigned char>(ch));
+        if (state == DEAD) return false;
+    }
+    return accepting[state] != 0;
+}
+
+size_t D2FA::count_match_ends(string_view input) const {
+    if (accepting.empty()) return 0;
+    uint32_t state = start_state;
+    size_t count = accepting[state];
+    for (char ch : input) {
+        state = next(state, static_cast<unsigned char>(ch));
+        if (state == DEAD) break;
+        count += accepting[state];
+    }
+    return count;
+}
+
+size_t D2FA::size_in_bytes() const {
+    size_t bytes = sizeof(*this)
+                 + label_begin.size() * sizeof(uint32_t)
+                 + labels.size()
+                 + targets.size() * sizeof(uint32_t)
+                 + default_state.size() * sizeof(uint32_t)
+                 + accepting.size();
+    for (const auto& ids : state_match_ids) bytes += sizeof(ids) + ids.size() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,64 @@
+#ifndef D2FA_H
+#define D2FA_H
+
+#include "dfa_table.h"
+#include "minimized_dfa.h"
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Delayed-input DFA (Kumar, Dharmapurikar, Yu, Crowley & Turner, 2006)
+
+Every state stores only the transitions that differ from its "default"
+state. On a byte without a stored transition the scanner follows the
+default pointer without consuming input and looks again, until it finds
+the transition or reaches a state without a default (missing transitions
+there lead to the dead state). Rule-set DFAs have many nearly identical
+rows, so most transitions disappear.
+
+Default pointers form a forest chosen as a maximum-weight spanning forest
+over "number of identical transitions", rooted at tree centers; chains
+longer than max_default_depth are cut, which bounds the extra lookups per
+input byte.
+*/
+class D2FA {
+public:
+    static constexpr uint32_t NO_DEFAULT = UINT32_MAX;
+
+    void build(const DFATable& table, unsigned max_default_depth = 4);
+    void build(const MinDFA& dfa, unsigned max_default_depth = 4);
+
+    uint32_t start() const { return start_state; }
+    uint32_t next(uint32_t state, unsigned char byte) const;
+    bool is_accepting(uint32_t state) const { return accepting[state] != 0; }
+    // Rule ids of an accepting state (only for labeled tables)
+    const std::vector<uint32_t>& match_ids(uint32_t state) const;
+
+    // Anchored: the whole input is in the language
+    bool matches(std::string_view input) const;
+    // Number of positions where the automaton accepts (use a search table
+    // to count match ends anywhere in the input)
+    size_t count_match_ends(std::string_view input) const;
+
+    size_t num_states() const { return accepting.size(); }
+    size_t stored_transitions() const { return targets.size(); }
+    unsigned max_depth() const { return depth_reached; }
+    size_t size_in_bytes() const;
+
+private:
+    uint32_t start_state = DFATable::DEAD_STATE;
+    std::array<uint8_t, 256> byte_class{};
+    // Stored transitions of state s: [label_begin[s], label_begin[s + 1]), sorted by class
+    std::vector<uint32_t> label_begin;
+    std::vector<uint8_t> labels;
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> default_state;
+    std::vector<uint8_t> accepting;
+    std::vector<std::vector<uint32_t>> state_match_ids;
+    unsigned depth_reached = 0;
+};
+
+#endif
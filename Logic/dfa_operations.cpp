@@ -0,0 +1,126 @@
+#include "dfa_operations.h"
+#include <queue>
+#include <utility>
+using namespace std;
+
+// Operations that combine finished automata without going back to the NFA.
+
+/*
+Union by product construction
+Each state of the result is a pair (state of a, state of b); nullptr stands
+for the implicit dead state of a partial DFA. The pair is accepting if
+either side is accepting.
+*/
+DFA union_dfa(const MinDFA& a, const MinDFA& b, const set<char>& input_symbols) {
+    using StatePair = pair<const MinDFAState*, const MinDFAState*>;
+
+    DFA dfa;
+    map<StatePair, shared_ptr<DFAState>> state_mapping;
+    queue<StatePair> to_process;
+    int dfa_state_id_counter = 0;
+
+    StatePair start(a.start_state.get(), b.start_state.get());
+    dfa.start_state = make_shared<DFAState>(dfa_state_id_counter++);
+    state_mapping[start] = dfa.start_state;
+    to_process.push(start);
+
+    while (!to_process.empty()) {
+        StatePair current = to_process.front();
+        to_process.pop();
+        auto current_dfa_state = state_mapping[current];
+        current_dfa_state->is_accepting = (current.first && current.first->is_accepting) ||
+                                          (current.second && current.second->is_accepting);
+
+        for (char symbol : input_symbols) {
+            StatePair next(nullptr, nullptr);
+            if (current.first) {
+                auto it = current.first->transitions.find(symbol);
+                if (it != current.first->transitions.end()) next.first = it->second.get();
+            }
+            if (current.second) {
+                auto it = current.second->transitions.find(symbol);
+                if (it != current.second->transitions.end()) next.second = it->second.get();
+            }
+            if (!next.first && !next.second) {
+                continue; // dead on both sides: no transition
+            }
+
+            auto found = state_mapping.find(next);
+            if (found == state_mapping.end()) {
+                found = state_mapping.emplace(next, make_shared<DFAState>(dfa_state_id_counter++)).first;
+                to_process.push(next);
+            }
+            current_dfa_state->transitions[symbol] = found->second;
+        }
+    }
+
+    for (const auto& [pair_key, dfa_state] : state_mapping) {
+        dfa.all_states.insert(dfa_state);
+    }
+    return dfa;
+}
+
+/*
+Union of many DFAs
+One component per operand, stored sparsely as (operand index, state) pairs
+so that operands which are already dead cost nothing. Only the symbols some
+live component has a transition on are followed. Every operand is already
+deterministic, so no ε-closures are needed and each state of an operand is
+visited only together with the states of the others it can co-occur with.
+*/
+DFA union_dfa(const vector<const MinDFA*>& dfas) {
+    using StateTuple = vector<pair<size_t, const MinDFAState*>>;
+
+    DFA dfa;
+    map<StateTuple, shared_ptr<DFAState>> state_mapping;
+    queue<StateTuple> to_process;
+    int dfa_state_id_counter = 0;
+
+    StateTuple start;
+    for (size_t i = 0; i < dfas.size(); ++i) {
+        if (dfas[i]->start_state) start.emplace_back(i, dfas[i]->start_state.get());
+    }
+    dfa.start_state = make_shared<DFAState>(dfa_state_id_counter++);
+    state_mapping[start] = dfa.start_state;
+    to_process.push(start);
+
+    map<char, StateTuple> successors;
+    while (!to_process.empty()) {
+        StateTuple current = move(to_process.front());
+        to_process.pop();
+        auto current_dfa_state = state_mapping[current];
+
+        // Components are in operand order, so each successor tuple comes out sorted
+        successors.clear();
+        for (const auto& [index, state] : current) {
+            if (state->is_accepting) current_dfa_state->is_accepting = true;
+            for (const auto& [symbol, next_state] : state->transitions) {
+                successors[symbol].emplace_back(index, next_state.get());
+            }
+        }
+
+        for (auto& [symbol, next] : successors) {
+            auto found = state_mapping.find(next);
+            if (found == state_mapping.end()) {
+                found = state_mapping.emplace(next, make_shared<DFAState>(dfa_state_id_counter++)).first;
+                to_process.push(move(next));
+            }
+            current_dfa_state->transitions[symbol] = found->second;
+        }
+    }
+
+    for (const auto& [tuple_key, dfa_state] : state_mapping) {
+        dfa.all_states.insert(dfa_state);
+    }
+    return dfa;
+}
+
+set<char> collect_input_symbols(const MinDFA& dfa) {
+    set<char> input_symbols;
+    for (const auto& state : dfa.all_states) {
+        for (const auto& [symbol, next_state] : state->transitions) {
+            input_symbols.insert(symbol);
+        }
+    }
+    return input_symbols;
+}
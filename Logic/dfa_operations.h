@@ -0,0 +1,17 @@
+#ifndef DFA_OPERATIONS_H
+#define DFA_OPERATIONS_H
+
+#include "nfa2dfa.h"
+#include "minimized_dfa.h"
+
+// Product construction: DFA accepting L(a) ∪ L(b)
+// input_symbols must cover the symbols of both DFAs.
+DFA union_dfa(const MinDFA& a, const MinDFA& b, const set<char>& input_symbols);
+
+// The same construction over any number of DFAs: L(dfas[0]) ∪ L(dfas[1]) ∪ ...
+DFA union_dfa(const std::vector<const MinDFA*>& dfas);
+
+// Input symbols (transition labels) of a minimized DFA
+set<char> collect_input_symbols(const MinDFA& dfa);
+
+#endif
@@ -0,0 +1,380 @@
+#include "dfa_table.h"
+
+#include <algorithm>
+#include <queue>
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+/*
+From MinDFA to a flat table
+
+Step 1 - number the states breadth-first from the start state (0 stays dead)
+Step 2 - compute byte classes: start with one class for all 256 bytes and,
+         for every state, split each class by the target its bytes lead to.
+         Only explicit transitions are looked at; bytes without one keep
+         their class (their target is the dead state).
+Step 3 - fill the rows; all bytes of a class have the same target in every
+         state, so one column per class is enough
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = DFATable::DEAD_STATE;
+
+struct VectorHash {
+    size_t operator()(const vector<uint32_t>& v) const {
+        uint64_t h = v.size();
+        for (uint32_t x : v) {
+            h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+// Renumber class ids to 0..n-1 in order of first byte
+uint32_t compact_classes(const array<int, 256>& raw, array<uint8_t, 256>& byte_class) {
+    unordered_map<int, uint32_t> renumber;
+    for (int b = 0; b < 256; ++b) {
+        auto it = renumber.emplace(raw[b], static_cast<uint32_t>(renumber.size())).first;
+        byte_class[b] = static_cast<uint8_t>(it->second);
+    }
+    return static_cast<uint32_t>(renumber.size());
+}
+
+// Sorted union of two id lists
+vector<uint32_t> merge_ids(const vector<uint32_t>& a, const vector<uint32_t>& b) {
+    vector<uint32_t> merged;
+    set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(merged));
+    return merged;
+}
+
+const vector<uint32_t>& ids_of(const DFATable& table, uint32_t state) {
+    static const vector<uint32_t> none;
+    return table.match_ids.empty() ? none : table.match_ids[state];
+}
+
+} // namespace
+
+size_t DFATable::memory_bytes() const {
+    size_t bytes = sizeof(DFATable)
+                 + transitions.size() * sizeof(uint32_t)
+                 + accepting.size();
+    for (const auto& ids : match_ids) {
+        bytes += sizeof(ids) + ids.size() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+DFATable build_dfa_table(const MinDFA& dfa, uint32_t match_id) {
+    DFATable table;
+
+    // Step 1: number states
+    vector<const MinDFAState*> order{nullptr};  // order[0] = dead state
+    unordered_map<const MinDFAState*, uint32_t> number;
+    if (dfa.start_state) {
+        number[dfa.start_state.get()] = 1;
+        order.push_back(dfa.start_state.get());
+        for (size_t i = 1; i < order.size(); ++i) {
+            for (const auto& [symbol, target] : order[i]->transitions) {
+                if (number.emplace(target.get(), static_cast<uint32_t>(order.size())).second) {
+                    order.push_back(target.get());
+                }
+            }
+        }
+        table.start = 1;
+    }
+
+    // Step 2: byte classes
+    array<int, 256> raw{};
+    int next_class = 1;
+    map<pair<int, uint32_t>, int> split;
+    for (size_t i = 1; i < order.size(); ++i) {
+        split.clear();
+        for (const auto& [symbol, target] : order[i]->transitions) {
+            unsigned char byte = static_cast<unsigned char>(symbol);
+            auto it = split.emplace(make_pair(raw[byte], number[target.get()]), next_class).first;
+            if (it->second == next_class) ++next_class;
+            raw[byte] = it->second;
+        }
+    }
+    table.num_classes = compact_classes(raw, table.byte_class);
+
+    // Step 3: rows
+    table.num_states = static_cast<uint32_t>(order.size());
+    table.transitions.assign(static_cast<size_t>(table.num_states) * table.num_classes, DEAD);
+    table.accepting.assign(table.num_states, 0);
+    if (match_id != UINT32_MAX) table.match_ids.resize(table.num_states);
+
+    for (size_t i = 1; i < order.size(); ++i) {
+        uint32_t* row = &table.transitions[i * table.num_classes];
+        for (const auto& [symbol, target] : order[i]->transitions) {
+            row[table.byte_class[static_cast<unsigned char>(symbol)]] = number[target.get()];
+        }
+        if (order[i]->is_accepting) {
+            table.accepting[i] = 1;
+            if (match_id != UINT32_MAX) table.match_ids[i].push_back(match_id);
+        }
+    }
+    return table;
+}
+
+/*
+Search table
+A state is the set of anchored states that are alive after the input so far.
+Because a match may start at any position, the anchored start state is
+added back after every byte, so the empty set (dead state) is never reached
+unless the pattern has no start state at all.
+*/
+bool build_search_table(const DFATable& anchored, DFATable& search, size_t max_states) {
+    search = DFATable();
+    search.byte_class = anchored.byte_class;
+    search.num_classes = anchored.num_classes;
+    search.transitions.assign(search.num_classes, DEAD);
+    search.accepting.assign(1, 0);
+    bool labeled = !anchored.match_ids.empty();
+    if (labeled) search.match_ids.resize(1);
+    if (anchored.start == DEAD) return true;
+
+    unordered_map<vector<uint32_t>, uint32_t, VectorHash> ids;
+    vector<vector<uint32_t>> subsets;
+
+    auto add_subset = [&](vector<uint32_t> subset) -> uint32_t {
+        auto it = ids.find(subset);
+        if (it != ids.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(subsets.size() + 1);
+        uint8_t is_accepting = 0;
+        vector<uint32_t> match;
+        for (uint32_t s : subset) {
+            is_accepting |= anchored.accepting[s];
+            if (labeled) match = merge_ids(match, anchored.match_ids[s]);
+        }
+        search.accepting.push_back(is_accepting);
+        if (labeled) search.match_ids.push_back(move(match));
+        search.transitions.resize(search.transitions.size() + search.num_classes, DEAD);
+        ids.emplace(subset, id);
+        subsets.push_back(move(subset));
+        return id;
+    };
+
+    search.start = add_subset({anchored.start});
+    vector<uint32_t> next;
+    for (size_t i = 0; i < subsets.size(); ++i) {
+        for (uint32_t c = 0; c < search.num_classes; ++c) {
+            next.assign(1, anchored.start);
+            for (uint32_t s : subsets[i]) {
+                uint32_t t = anchored.transitions[static_cast<size_t>(s) * anchored.num_classes + c];
+                if (t != DEAD) next.push_back(t);
+            }
+            sort(next.begin(), next.end());
+            next.erase(unique(next.begin(), next.end()), next.end());
+
+            uint32_t target = add_subset(next);
+            if (subsets.size() + 1 > max_states) return false;
+            search.transitions[(i + 1) * search.num_classes + c] = target;
+        }
+    }
+    search.num_states = static_cast<uint32_t>(subsets.size() + 1);
+    return true;
+}
+
+bool build_reverse_table(const DFATable& anchored, DFATable& reverse, size_t max_states) {
+    reverse = DFATable();
+    reverse.byte_class = anchored.byte_class;
+    reverse.num_classes = anchored.num_classes;
+    reverse.transitions.assign(reverse.num_classes, DEAD);
+    reverse.accepting.assign(1, 0);
+
+    // predecessors[c * num_states + t] = live states that reach t on class c
+    const uint32_t classes = anchored.num_classes;
+    vector<vector<uint32_t>> predecessors(static_cast<size_t>(classes) * anchored.num_states);
+    vector<uint32_t> finals;
+    for (uint32_t s = 1; s < anchored.num_states; ++s) {
+        if (anchored.accepting[s]) finals.push_back(s);
+        for (uint32_t c = 0; c < classes; ++c) {
+            uint32_t t = anchored.transitions[static_cast<size_t>(s) * classes + c];
+            if (t != DEAD) predecessors[static_cast<size_t>(c) * anchored.num_states + t].push_back(s);
+        }
+    }
+    if (anchored.start == DEAD || finals.empty()) return true;
+
+    unordered_map<vector<uint32_t>, uint32_t, VectorHash> ids;
+    vector<vector<uint32_t>> subsets;
+    ids.emplace(vector<uint32_t>(), DEAD);
+
+    auto add_subset = [&](vector<uint32_t>& subset) -> uint32_t {
+        auto [it, inserted] = ids.emplace(subset, static_cast<uint32_t>(subsets.size() + 1));
+        if (inserted) {
+            reverse.accepting.push_back(binary_search(subset.begin(), subset.end(), anchored.start) ? 1 : 0);
+            reverse.transitions.resize(reverse.transitions.size() + classes, DEAD);
+            subsets.push_back(subset);
+        }
+        return it->second;
+    };
+
+    reverse.start = add_subset(finals);
+    vector<uint32_t> next;
+    for (size_t i = 0; i < subsets.size(); ++i) {
+        for (uint32_t c = 0; c < classes; ++c) {
+            next.clear();
+            for (uint32_t t : subsets[i]) {
+                const auto& sources = predecessors[static_cast<size_t>(c) * anchored.num_states + t];
+                next.insert(next.end(), sources.begin(), sources.end());
+            }
+            sort(next.begin(), next.end());
+            next.erase(unique(next.begin(), next.end()), next.end());
+
+            uint32_t target = add_subset(next);
+            if (subsets.size() + 1 > max_states) return false;
+            reverse.transitions[(i + 1) * classes + c] = target;
+        }
+    }
+    reverse.num_states = static_cast<uint32_t>(subsets.size() + 1);
+    return true;
+}
+
+/*
+Union by product construction
+A product state is a pair (state of a, state of b); the pair of dead states
+is the dead state of the result. The result's byte classes are the pairs of
+(class in a, class in b) that actually occur among the 256 bytes.
+*/
+size_t union_dfa_tables(const DFATable& a, const DFATable& b, size_t max_states, DFATable* out) {
+    // Joint byte classes and a representative column in a and b for each
+    array<int, 256> raw{};
+    for (int byte = 0; byte < 256; ++byte) {
+        raw[byte] = a.byte_class[byte] * static_cast<int>(b.num_classes) + b.byte_class[byte];
+    }
+    array<uint8_t, 256> byte_class{};
+    uint32_t num_classes = compact_classes(raw, byte_class);
+    vector<uint32_t> column_a(num_classes), column_b(num_classes);
+    for (int byte = 0; byte < 256; ++byte) {
+        column_a[byte_class[byte]] = a.byte_class[byte];
+        column_b[byte_class[byte]] = b.byte_class[byte];
+    }
+
+    unordered_map<uint64_t, uint32_t> ids;
+    vector<pair<uint32_t, uint32_t>> pairs{{DEAD, DEAD}};
+    ids.emplace(0, DEAD);
+    auto pair_id = [&](uint32_t sa, uint32_t sb) -> uint32_t {
+        auto [it, inserted] = ids.emplace(static_cast<uint64_t>(sa) << 32 | sb,
+                                          static_cast<uint32_t>(pairs.size()));
+        if (inserted) pairs.emplace_back(sa, sb);
+        return it->second;
+    };
+
+    if (out) {
+        *out = DFATable();
+        out->byte_class = byte_class;
+        out->num_classes = num_classes;
+    }
+    uint32_t start = pair_id(a.start, b.start);
+    vector<uint32_t> row(num_classes);
+    for (size_t i = 1; i < pairs.size(); ++i) {
+        auto [sa, sb] = pairs[i];
+        for (uint32_t c = 0; c < num_classes; ++c) {
+            row[c] = pair_id(a.transitions[static_cast<size_t>(sa) * a.num_classes + column_a[c]],
+                             b.transitions[static_cast<size_t>(sb) * b.num_classes + column_b[c]]);
+        }
+        if (pairs.size() > max_states) return 0;
+        if (out) {
+            if (out->transitions.empty()) out->transitions.assign(num_classes, DEAD); // row of the dead state
+            out->transitions.insert(out->transitions.end(), row.begin(), row.end());
+        }
+    }
+
+    if (out) {
+        out->start = start;
+        out->num_states = static_cast<uint32_t>(pairs.size());
+        out->transitions.resize(static_cast<size_t>(out->num_states) * num_classes, DEAD);
+        out->accepting.assign(out->num_states, 0);
+        bool labeled = !a.match_ids.empty() || !b.match_ids.empty();
+        if (labeled) out->match_ids.resize(out->num_states);
+        for (size_t i = 1; i < pairs.size(); ++i) {
+            auto [sa, sb] = pairs[i];
+            out->accepting[i] = a.accepting[sa] | b.accepting[sb];
+            if (labeled) out->match_ids[i] = merge_ids(ids_of(a, sa), ids_of(b, sb));
+        }
+    }
+    return pairs.size();
+}
+
+/*
+Moore's algorithm on the table
+Initial blocks: states with the same accepting flag and rule ids.
+Every round splits blocks by (own block, block of the target in every
+column) until the number of blocks stops growing. Blocks that cannot reach
+an accepting state end up together with the dead state.
+*/
+DFATable minimize_dfa_table(const DFATable& table) {
+    const uint32_t n = table.num_states;
+    const uint32_t classes = table.num_classes;
+
+    vector<uint32_t> block(n);
+    size_t num_blocks;
+    {
+        map<pair<uint8_t, vector<uint32_t>>, uint32_t> initial;
+        for (uint32_t s = 0; s < n; ++s) {
+            auto key = make_pair(table.accepting[s], ids_of(table, s));
+            block[s] = initial.emplace(move(key), static_cast<uint32_t>(initial.size())).first->second;
+        }
+        num_blocks = initial.size();
+    }
+
+    unordered_map<vector<uint32_t>, uint32_t, VectorHash> signatures;
+    vector<uint32_t> signature(classes + 1);
+    vector<uint32_t> next_block(n);
+    while (true) {
+        signatures.clear();
+        for (uint32_t s = 0; s < n; ++s) {
+            signature[0] = block[s];
+            const uint32_t* row = &table.transitions[static_cast<size_t>(s) * classes];
+            for (uint32_t c = 0; c < classes; ++c) {
+                signature[c + 1] = block[row[c]];
+            }
+            next_block[s] = signatures.emplace(signature, static_cast<uint32_t>(signatures.size())).first->second;
+        }
+        block.swap(next_block);
+        if (signatures.size() == num_blocks) break;
+        num_blocks = signatures.size();
+    }
+
+    // Renumber blocks: the dead state's block stays 0, the rest by first state
+    vector<uint32_t> renumber(num_blocks, UINT32_MAX);
+    renumber[block[DEAD]] = DEAD;
+    uint32_t count = 1;
+    for (uint32_t s = 0; s < n; ++s) {
+        if (renumber[block[s]] == UINT32_MAX) renumber[block[s]] = count++;
+    }
+
+    DFATable result;
+    result.byte_class = table.byte_class;
+    result.num_classes = classes;
+    result.num_states = count;
+    result.start = renumber[block[table.start]];
+    result.transitions.assign(static_cast<size_t>(count) * classes, DEAD);
+    result.accepting.assign(count, 0);
+    if (!table.match_ids.empty()) result.match_ids.resize(count);
+    for (uint32_t s = 0; s < n; ++s) {
+        uint32_t target = renumber[block[s]];
+        if (target == DEAD) continue;
+        for (uint32_t c = 0; c < classes; ++c) {
+            result.transitions[static_cast<size_t>(target) * classes + c] =
+                renumber[block[table.transitions[static_cast<size_t>(s) * classes + c]]];
+        }
+        result.accepting[target] = table.accepting[s];
+        if (!table.match_ids.empty()) result.match_ids[target] = table.match_ids[s];
+    }
+    return result;
+}
+
+bool dfa_table_match(const DFATable& table, string_view input) {
+    uint32_t state = table.start;
+    for (char ch : input) {
+        state = table.next(state, static_cast<unsigned char>(ch));
+        if (state == DEAD) return false;
+    }
+    return table.accepting[state] != 0;
+}
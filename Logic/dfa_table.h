@@ -0,0 +1,64 @@
+#ifndef DFA_TABLE_H
+#define DFA_TABLE_H
+
+#include "minimized_dfa.h"
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Flat DFA for scanning: one row per state, one column per byte class.
+
+- State 0 is the dead state: every transition of row 0 leads back to 0,
+  and missing transitions of the linked DFA point to it.
+- Bytes that behave identically in every state share a byte class, so a
+  regex over [a-z0-9] needs a handful of columns instead of 256.
+- Multi-pattern tables (unions of several rules) list the ids of the rules
+  matched in each accepting state in match_ids; single-pattern tables
+  leave it empty.
+*/
+struct DFATable {
+    static constexpr uint32_t DEAD_STATE = 0;
+
+    uint32_t start = DEAD_STATE;
+    uint32_t num_states = 1;
+    uint32_t num_classes = 1;
+    std::array<uint8_t, 256> byte_class{};     // byte -> column
+    std::vector<uint32_t> transitions;         // num_states * num_classes
+    std::vector<uint8_t> accepting;
+    std::vector<std::vector<uint32_t>> match_ids;
+
+    uint32_t next(uint32_t state, unsigned char byte) const {
+        return transitions[static_cast<size_t>(state) * num_classes + byte_class[byte]];
+    }
+    size_t memory_bytes() const;
+};
+
+// Anchored table from a minimized DFA; match_id != UINT32_MAX labels every
+// accepting state with that rule id
+DFATable build_dfa_table(const MinDFA& dfa, uint32_t match_id = UINT32_MAX);
+
+// Unanchored table for L = Σ*·L(anchored): accepting after byte i means some
+// match ends at i. Subset construction with the start state re-added after
+// every byte; returns false if more than max_states states would be needed.
+bool build_search_table(const DFATable& anchored, DFATable& search, size_t max_states);
+
+// Table for the reversed language, fed the input backwards: accepting after
+// reading bytes j-1 down to i means [i, j) is a match. Subset construction
+// over predecessor sets; unlabeled. Returns false past max_states states.
+bool build_reverse_table(const DFATable& anchored, DFATable& reverse, size_t max_states);
+
+// Product construction of two tables; out == nullptr only counts states.
+// Returns the number of states (including the dead state), or 0 if it would
+// exceed max_states.
+size_t union_dfa_tables(const DFATable& a, const DFATable& b, size_t max_states, DFATable* out);
+
+// Moore partition refinement; states only merge if they accept the same rule ids
+DFATable minimize_dfa_table(const DFATable& table);
+
+// Whole-input match against an anchored table
+bool dfa_table_match(const DFATable& table, std::string_view input);
+
+#endif
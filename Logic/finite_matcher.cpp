@@ -0,0 +1,371 @@
+#include "finite_matcher.h"
+#include "thompsons_construction.h"
+#include "literal_set.h"
+#include "compiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <map>
+using namespace std;
+
+// This file detects regexes without a (non-trivial) Kleene star and builds
+// an exact-match structure for their finite language.
+
+namespace {
+
+// Up to this many words are stored in a perfect hash table, above it a DAWG
+constexpr size_t MAX_PACKED_WORDS = 1u << 20;
+constexpr size_t MAX_STRING_WORDS = 1u << 16;
+
+// Buckets of the perfect hash hold this many keys on average
+constexpr size_t KEYS_PER_BUCKET = 4;
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Word hash: 8 bytes per step; the length is mixed in so "ab" and "ab\0" differ
+uint64_t word_hash(string_view word, uint64_t seed) {
+    uint64_t h = mix64(seed ^ (word.size() * 0x9e3779b97f4a7c15ULL));
+    size_t i = 0;
+    for (; i + 8 <= word.size(); i += 8) {
+        uint64_t block;
+        memcpy(&block, word.data() + i, 8);
+        h = mix64(h ^ block);
+    }
+    if (i < word.size()) {
+        uint64_t block = 0;
+        memcpy(&block, word.data() + i, word.size() - i);
+        h = mix64(h ^ block);
+    }
+    return h;
+}
+
+uint64_t pack_word(string_view word) {
+    uint64_t key = 0;
+    memcpy(&key, word.data(), word.size());
+    return key;
+}
+
+// Parts of one word hash used by the perfect hash
+uint32_t bucket_part(uint64_t h) { return static_cast<uint32_t>(h >> 32); }
+uint32_t first_part(uint64_t h) { return static_cast<uint32_t>(h); }
+uint32_t second_part(uint64_t h) { return static_cast<uint32_t>(mix64(h)); }
+
+// ε, or a tree that can only produce ε
+bool only_empty(const TreeNode* node) {
+    if (node->value == '.' || node->value == '|') {
+        vector<const TreeNode*> operands;
+        flatten_chain(node, node->value, operands);
+        return all_of(operands.begin(), operands.end(), only_empty);
+    }
+    if (node->value == '*') return only_empty(node->left);
+    return node->value == EPSILON;
+}
+
+// Language of a star-free subtree; false once it grows past max_words
+bool enumerate(const TreeNode* node, vector<string>& out, size_t max_words) {
+    if (node->value == '|' || node->value == '.') {
+        vector<const TreeNode*> operands;
+        flatten_chain(node, node->value, operands);
+
+        vector<string> operand_words;
+        if (node->value == '|') {
+            size_t dedup_limit = max_words;
+            for (const TreeNode* operand : operands) {
+                operand_words.clear();
+                if (!enumerate(operand, operand_words, max_words)) return false;
+                out.insert(out.end(), operand_words.begin(), operand_words.end());
+                if (out.size() > dedup_limit) {
+                    // only pay for deduplication when the limit looks exceeded
+                    sort(out.begin(), out.end());
+                    out.erase(unique(out.begin(), out.end()), out.end());
+                    if (out.size() > max_words) return false;
+                    dedup_limit = out.size() + max_words;
+                }
+            }
+            sort(out.begin(), out.end());
+            out.erase(unique(out.begin(), out.end()), out.end());
+            return true;
+        }
+
+        // concatenation: cross product, operand by operand
+        vector<string> product{string()};
+        for (const TreeNode* operand : operands) {
+            operand_words.clear();
+            if (!enumerate(operand, operand_words, max_words)) return false;
+            if (product.size() * operand_words.size() > max_words) return false;
+
+            vector<string> next;
+            next.reserve(product.size() * operand_words.size());
+            for (const string& prefix : product) {
+                for (const string& suffix : operand_words) {
+                    next.push_back(prefix + suffix);
+                }
+            }
+            product.swap(next);
+        }
+        sort(product.begin(), product.end());
+        product.erase(unique(product.begin(), product.end()), product.end());
+        out.insert(out.end(), product.begin(), product.end());
+        return true;
+    }
+    if (node->value == '*') {
+        if (!only_empty(node->left)) return false; // infinite
+        out.push_back(string());
+        return true;
+    }
+    if (node->value == CHAR_CLASS) {
+        vector<char> symbols;
+        expand_char_class(*node->char_class, symbols);
+        if (symbols.size() > max_words) return false;
+        for (char symbol : symbols) out.push_back(string(1, symbol));
+        return true;
+    }
+    out.push_back(node->value == EPSILON ? string() : string(1, node->value));
+    return true;
+}
+
+} // namespace
+
+bool is_finite_language(const TreeNode* root) {
+    if (!root) return false;
+    if (root->value == '.' || root->value == '|') {
+        // chains are flattened so long literals do not recurse once per symbol
+        vector<const TreeNode*> operands;
+        flatten_chain(root, root->value, operands);
+        return all_of(operands.begin(), operands.end(), is_finite_language);
+    }
+    if (root->value == '*') return only_empty(root->left);
+    return true;
+}
+
+bool enumerate_words(const TreeNode* root, vector<string>& words, size_t max_words) {
+    if (!root || !is_finite_language(root)) return false;
+    vector<string> found;
+    if (!enumerate(root, found, max_words)) return false;
+    words.insert(words.end(), found.begin(), found.end());
+    return true;
+}
+
+bool FiniteMatcher::build(const TreeNode* root) {
+    if (!is_finite_language(root)) return false;
+
+    vector<string> words;
+    if (enumerate_words(root, words, MAX_PACKED_WORDS)) {
+        build_from_words(move(words));
+    } else {
+        build_from_dfa(compile_min_dfa(root));
+    }
+    return true;
+}
+
+void FiniteMatcher::build_from_words(vector<string> words) {
+    *this = FiniteMatcher();
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        current_mode = Mode::PackedHash;   // no slots: matches() is always false
+        return;
+    }
+
+    max_length = 0;
+    for (const string& word : words) {
+        max_length = max(max_length, word.size());
+    }
+
+    bool packed = max_length <= 8 && words.size() <= MAX_PACKED_WORDS;
+    if (!packed && words.size() > MAX_STRING_WORDS) {
+        build_from_dfa(build_literal_dfa(move(words)));
+        return;
+    }
+
+    vector<uint32_t> slot_words = build_perfect_hash(words);
+    if (packed) {
+        current_mode = Mode::PackedHash;
+        packed_keys.resize(table_size);
+        packed_lengths.resize(table_size);
+        for (size_t slot = 0; slot < table_size; ++slot) {
+            const string& word = words[slot_words[slot]];
+            packed_keys[slot] = pack_word(word);
+            packed_lengths[slot] = static_cast<uint8_t>(word.size());
+        }
+    } else {
+        current_mode = Mode::StringHash;
+        offsets.assign(1, 0);
+        text.clear();
+        for (size_t slot = 0; slot < table_size; ++slot) {
+            text += words[slot_words[slot]];
+            offsets.push_back(static_cast<uint32_t>(text.size()));
+        }
+    }
+}
+
+/*
+Hash and displace (Belazzougui et al. / rust-phf style)
+1. hash every word once into (bucket, f1, f2)
+2. place buckets largest first: find the first (d1, d2) for which every
+   word of the bucket lands on a distinct free slot (f1 + d1 * f2 + d2) % n
+3. if some bucket cannot be placed, start over with a new seed
+The table has exactly one slot per word (minimal).
+*/
+vector<uint32_t> FiniteMatcher::build_perfect_hash(const vector<string>& words) {
+    table_size = words.size();
+    size_t num_buckets = (table_size + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+
+    for (seed = 0;; ++seed) {
+        vector<uint64_t> hashes(words.size());
+        vector<vector<uint32_t>> buckets(num_buckets);
+        for (size_t i = 0; i < words.size(); ++i) {
+            hashes[i] = word_hash(words[i], seed);
+            buckets[bucket_part(hashes[i]) % num_buckets].push_back(static_cast<uint32_t>(i));
+        }
+
+        vector<uint32_t> order(num_buckets);
+        for (size_t b = 0; b < num_buckets; ++b) order[b] = static_cast<uint32_t>(b);
+        stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        displacements.assign(num_buckets, {0, 0});
+        vector<uint32_t> slot_words(table_size, UINT32_MAX);
+        vector<uint64_t> try_mark(table_size, 0);  // slot -> attempt that last used it
+        uint64_t attempt = 0;
+        bool placed_all = true;
+
+        for (uint32_t b : order) {
+            const vector<uint32_t>& keys = buckets[b];
+            if (keys.empty()) break; // sorted, the rest is empty too
+
+            bool placed = false;
+            for (uint64_t d1 = 0; d1 < table_size && !placed; ++d1) {
+                for (uint64_t d2 = 0; d2 < table_size && !placed; ++d2) {
+                    ++attempt;
+                    bool fits = true;
+                    for (uint32_t key : keys) {
+                        size_t slot = (first_part(hashes[key]) + d1 * second_part(hashes[key]) + d2) % table_size;
+                        if (slot_words[slot] != UINT32_MAX || try_mark[slot] == attempt) {
+                            fits = false;
+                            break;
+                        }
+                        try_mark[slot] = attempt;
+                    }
+                    if (fits) {
+                        for (uint32_t key : keys) {
+                            size_t slot = (first_part(hashes[key]) + d1 * second_part(hashes[key]) + d2) % table_size;
+                            slot_words[slot] = key;
+                        }
+                        displacements[b] = {static_cast<uint32_t>(d1), static_cast<uint32_t>(d2)};
+                        placed = true;
+                    }
+                }
+            }
+            if (!placed) {
+                placed_all = false;
+                break;
+            }
+        }
+        if (placed_all) return slot_words;
+    }
+}
+
+// Only called on a non-empty table
+size_t FiniteMatcher::find_slot(uint64_t hash) const {
+    const auto& [d1, d2] = displacements[bucket_part(hash) % displacements.size()];
+    return (first_part(hash) + static_cast<uint64_t>(d1) * second_part(hash) + d2) % table_size;
+}
+
+void FiniteMatcher::build_from_dfa(const MinDFA& dfa) {
+    *this = FiniteMatcher();
+    current_mode = Mode::DAWG;
+    edge_begin.assign(1, 0);
+
+    // Number states in BFS order so the start state is 0
+    map<const MinDFAState*, uint32_t> ids;
+    vector<const MinDFAState*> order;
+    vector<size_t> depth;
+    ids[dfa.start_state.get()] = 0;
+    order.push_back(dfa.start_state.get());
+    depth.push_back(0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& [symbol, next_state] : order[i]->transitions) {
+            if (ids.emplace(next_state.get(), static_cast<uint32_t>(order.size())).second) {
+                order.push_back(next_state.get());
+                depth.push_back(depth[i] + 1);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        accepting.push_back(order[i]->is_accepting);
+        for (const auto& [symbol, next_state] : order[i]->transitions) {
+            edge_symbols.push_back(symbol);
+            edge_targets.push_back(ids[next_state.get()]);
+        }
+        edge_begin.push_back(static_cast<uint32_t>(edge_symbols.size()));
+    }
+
+    // Longest word = longest path in the acyclic DFA (reverse topological pass)
+    vector<size_t> longest(order.size(), 0);
+    vector<int> indegree(order.size(), 0);
+    for (uint32_t target : edge_targets) ++indegree[target];
+    vector<uint32_t> topo;
+    for (uint32_t s = 0; s < order.size(); ++s) {
+        if (indegree[s] == 0) topo.push_back(s);
+    }
+    for (size_t i = 0; i < topo.size(); ++i) {
+        for (uint32_t e = edge_begin[topo[i]]; e < edge_begin[topo[i] + 1]; ++e) {
+            if (--indegree[edge_targets[e]] == 0) topo.push_back(edge_targets[e]);
+        }
+    }
+    for (auto it = topo.rbegin(); it != topo.rend(); ++it) {
+        for (uint32_t e = edge_begin[*it]; e < edge_begin[*it + 1]; ++e) {
+            longest[*it] = max(longest[*it], longest[edge_targets[e]] + 1);
+        }
+    }
+    max_length = longest.empty() ? 0 : longest[0];
+}
+
+bool FiniteMatcher::matches(string_view input) const {
+    if (input.size() > max_length) return false;
+    // Empty language (no hash slots) or a matcher that was never built (no DAWG states)
+    if (current_mode == Mode::DAWG ? accepting.empty() : table_size == 0) return false;
+
+    switch (current_mode) {
+        case Mode::PackedHash: {
+            size_t slot = find_slot(word_hash(input, seed));
+            return packed_lengths[slot] == input.size() && packed_keys[slot] == pack_word(input);
+        }
+        case Mode::StringHash: {
+            size_t slot = find_slot(word_hash(input, seed));
+            string_view stored(text.data() + offsets[slot], offsets[slot + 1] - offsets[slot]);
+            return stored == input;
+        }
+        case Mode::DAWG: {
+            uint32_t state = 0;
+            for (char c : input) {
+                auto begin = edge_symbols.begin() + edge_begin[state];
+                auto end = edge_symbols.begin() + edge_begin[state + 1];
+                auto it = lower_bound(begin, end, c);
+                if (it == end || *it != c) return false;
+                state = edge_targets[it - edge_symbols.begin()];
+            }
+            return accepting[state];
+        }
+    }
+    return false;
+}
+
+size_t FiniteMatcher::size_in_bytes() const {
+    return displacements.size() * sizeof(displacements[0]) +
+           packed_keys.size() * sizeof(uint64_t) + packed_lengths.size() +
+           offsets.size() * sizeof(uint32_t) + text.size() +
+           edge_begin.size() * sizeof(uint32_t) + edge_symbols.size() +
+           edge_targets.size() * sizeof(uint32_t) + accepting.size();
+}
@@ -0,0 +1,76 @@
+#ifndef FINITE_MATCHER_H
+#define FINITE_MATCHER_H
+
+#include "parser.h"
+#include "minimized_dfa.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// True if the regex has no '*' that can repeat a non-empty string,
+// i.e. its language is finite (ε* and (ε|ε)* count as ε)
+bool is_finite_language(const TreeNode* root);
+
+// All words of a finite regex, deduplicated; false if the regex is not
+// finite or has more than max_words words
+bool enumerate_words(const TreeNode* root, std::vector<std::string>& words, size_t max_words);
+
+/*
+Exact-match lookup for a finite language.
+
+- PackedHash: every word has at most 8 bytes; words are packed into a
+  uint64_t and stored in a minimal perfect hash table
+- StringHash: short word lists with longer words; minimal perfect hash
+  table over the words themselves
+- DAWG: large languages; the minimal acyclic DFA in compact arrays
+
+A lookup in the hash modes is one hash computation, one displacement read
+and one key compare instead of a DFA walk.
+*/
+class FiniteMatcher {
+public:
+    enum class Mode { PackedHash, StringHash, DAWG };
+
+    // Returns false if the regex is not finite
+    bool build(const TreeNode* root);
+    void build_from_words(std::vector<std::string> words);
+    // Minimized DFA of a finite language (must be acyclic)
+    void build_from_dfa(const MinDFA& dfa);
+
+    bool matches(std::string_view input) const;
+
+    Mode mode() const { return current_mode; }
+    size_t size_in_bytes() const;
+
+private:
+    Mode current_mode = Mode::DAWG;
+    size_t max_length = 0;
+
+    // Minimal perfect hash (hash and displace): bucket = h.g % buckets,
+    // slot = (h.f1 + d1 * h.f2 + d2) % table_size with (d1, d2) per bucket
+    uint64_t seed = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> displacements;
+    size_t table_size = 0;
+
+    // PackedHash slots
+    std::vector<uint64_t> packed_keys;
+    std::vector<uint8_t> packed_lengths;
+
+    // StringHash slots: word i is text[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> offsets;
+    std::string text;
+
+    // DAWG in CSR form: edges of state s are [edge_begin[s], edge_begin[s + 1])
+    std::vector<uint32_t> edge_begin;
+    std::vector<char> edge_symbols;
+    std::vector<uint32_t> edge_targets;
+    std::vector<uint8_t> accepting;
+
+    size_t find_slot(uint64_t hash) const;
+    // Fills displacements; returns the word stored in every slot
+    std::vector<uint32_t> build_perfect_hash(const std::vector<std::string>& words);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "flow_matcher.h"
+
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+constexpr uint32_t DEAD = DFATable::DEAD_STATE;
+constexpr uint32_t FLAG_MASK = (1u << FlowState::FLAG_BITS) - 1;
+
+// Flows per prefetch group in scan_bulk: enough to hide a cache miss,
+// few enough that the prefetched lines are still cached when used
+constexpr size_t BULK_GROUP = 32;
+
+size_t round_up_pow2(size_t n) {
+    size_t capacity = 16;
+    while (capacity < n) capacity *= 2;
+    return capacity;
+}
+
+} // namespace
+
+FlowTable::FlowTable(size_t expected_flows) {
+    size_t capacity = round_up_pow2(expected_flows + expected_flows / 3 + 1);
+    keys.assign(capacity, 0);
+    states.assign(capacity, FlowState());
+    mask = capacity - 1;
+}
+
+// splitmix64 finalizer: flow ids are often sequential or share low bits
+size_t FlowTable::hash(uint64_t flow) {
+    flow ^= flow >> 30;
+    flow *= 0xbf58476d1ce4e5b9ULL;
+    flow ^= flow >> 27;
+    flow *= 0x94d049bb133111ebULL;
+    flow ^= flow >> 31;
+    return static_cast<size_t>(flow);
+}
+
+FlowState* FlowTable::find(uint64_t flow) {
+    for (size_t slot = hash(flow) & mask; states[slot].bits != 0; slot = (slot + 1) & mask) {
+        if (keys[slot] == flow) return &states[slot];
+    }
+    return nullptr;
+}
+
+size_t FlowTable::find_or_insert_slot(uint64_t flow) {
+    if ((count + 1) * 4 > keys.size() * 3) reserve(count + 1);
+    size_t slot = hash(flow) & mask;
+    for (; states[slot].bits != 0; slot = (slot + 1) & mask) {
+        if (keys[slot] == flow) return slot;
+    }
+    keys[slot] = flow;
+    states[slot].bits = FlowState::IN_USE;
+    ++count;
+    return slot;
+}
+
+bool FlowTable::erase(uint64_t flow) {
+    size_t hole = hash(flow) & mask;
+    for (; states[hole].bits != 0 && keys[hole] != flow; hole = (hole + 1) & mask) {}
+    if (states[hole].bits == 0) return false;
+
+    // Backward shift: pull later entries of the probe run into the hole
+    // unless their home slot lies cyclically in (hole, slot]
+    for (size_t slot = (hole + 1) & mask; states[slot].bits != 0; slot = (slot + 1) & mask) {
+        size_t home = hash(keys[slot]) & mask;
+        bool stays = hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot);
+        if (stays) continue;
+        keys[hole] = keys[slot];
+        states[hole] = states[slot];
+        hole = slot;
+    }
+    states[hole].bits = 0;
+    --count;
+    return true;
+}
+
+void FlowTable::reserve(size_t flows) {
+    size_t capacity = round_up_pow2(flows + flows / 3 + 1);
+    if (capacity <= keys.size()) return;
+
+    vector<uint64_t> old_keys(capacity, 0);
+    vector<FlowState> old_states(capacity, FlowState());
+    old_keys.swap(keys);
+    old_states.swap(states);
+    mask = capacity - 1;
+    for (size_t i = 0; i < old_keys.size(); ++i) {
+        if (old_states[i].bits == 0) continue;
+        size_t slot = hash(old_keys[i]) & mask;
+        while (states[slot].bits != 0) slot = (slot + 1) & mask;
+        keys[slot] = old_keys[i];
+        states[slot] = old_states[i];
+    }
+}
+
+void FlowTable::prefetch(uint64_t flow) const {
+    size_t slot = hash(flow) & mask;
+    __builtin_prefetch(&keys[slot]);
+    __builtin_prefetch(&states[slot]);
+}
+
+bool FlowMatcher::build(const DFATable& dfa, bool first_match_only) {
+    if (dfa.num_states > FlowState::MAX_STATES) return false;
+    table = dfa;
+    stop_at_first = first_match_only;
+    return true;
+}
+
+void FlowMatcher::report(uint32_t state, uint64_t flow, size_t index, size_t end, vector<FlowMatch>& matches) const {
+    const vector<uint32_t>* ids = state < table.match_ids.size() ? &table.match_ids[state] : nullptr;
+    if (!ids || ids->empty()) {
+        matches.push_back({flow, UINT32_MAX, index, end});
+        return;
+    }
+    for (uint32_t id : *ids) matches.push_back({flow, id, index, end});
+}
+
+void FlowMatcher::scan(FlowState& flow_state, uint64_t flow, string_view chunk, size_t index,
+                       vector<FlowMatch>* matches) const {
+    uint32_t flags = flow_state.bits & FLAG_MASK;
+    if (flags & FlowState::FINISHED) return;
+
+    uint32_t state = flow_state.dfa_state();
+    if (!(flags & FlowState::STARTED)) {
+        state = table.start;
+        flags |= FlowState::STARTED;
+        if (table.accepting[state]) {
+            flags |= FlowState::MATCHED;
+            if (matches) report(state, flow, index, 0, *matches);
+            if (stop_at_first) flags |= FlowState::FINISHED;
+        }
+    }
+
+    for (size_t i = 0; i < chunk.size() && !(flags & FlowState::FINISHED); ++i) {
+        state = table.next(state, static_cast<unsigned char>(chunk[i]));
+        if (state == DEAD) {
+            flags |= FlowState::FINISHED;
+        } else if (table.accepting[state]) {
+            flags |= FlowState::MATCHED;
+            if (matches) report(state, flow, index, i + 1, *matches);
+            if (stop_at_first) flags |= FlowState::FINISHED;
+        }
+    }
+    flow_state.bits = (state << FlowState::FLAG_BITS) | flags;
+}
+
+/*
+Bulk scan, per group of BULK_GROUP chunks
+Step 1 - Prefetch the table slot of every flow
+Step 2 - Look up or insert each flow (room is reserved first, so slots stay
+         put) and prefetch the transition row its next byte will read
+Step 3 - Scan the chunks in batch order
+*/
+void FlowMatcher::scan_bulk(FlowTable& flows, const FlowChunk* chunks, size_t count, FlowScratch& scratch,
+                            vector<FlowMatch>& matches) const {
+    scratch.slots.resize(BULK_GROUP);
+    for (size_t group = 0; group < count; group += BULK_GROUP) {
+        const size_t n = min(BULK_GROUP, count - group);
+        flows.reserve(flows.size() + n);
+
+        // Step 1
+        for (size_t k = 0; k < n; ++k) flows.prefetch(chunks[group + k].flow);
+
+        // Step 2
+        for (size_t k = 0; k < n; ++k) {
+            size_t slot = flows.find_or_insert_slot(chunks[group + k].flow);
+            scratch.slots[k] = slot;
+            const FlowState& state = flows.states[slot];
+            uint32_t dfa_state = state.has(FlowState::STARTED) ? state.dfa_state() : table.start;
+            __builtin_prefetch(&table.transitions[static_cast<size_t>(dfa_state) * table.num_classes]);
+        }
+
+        // Step 3
+        for (size_t k = 0; k < n; ++k) {
+            const FlowChunk& chunk = chunks[group + k];
+            scan(flows.states[scratch.slots[k]], chunk.flow, chunk.data, group + k, &matches);
+        }
+    }
+}
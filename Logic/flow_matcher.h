@@ -0,0 +1,115 @@
+#ifndef FLOW_MATCHER_H
+#define FLOW_MATCHER_H
+
+#include "dfa_table.h"
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Streaming matches for many concurrent flows
+
+Between two chunks of a flow nothing but its DFA state has to survive, so
+the per-flow state is one 32-bit word: the state id in the high 28 bits
+and four flags. Everything else is shared (the matcher, read-only) or per
+thread (FlowTable, FlowScratch, the match vector): shard the flows over
+threads, e.g. by flow hash, and give each thread its own table.
+
+FlowTable maps 64-bit flow ids to states with open addressing (linear
+probing, backward-shift deletion), keys and states in separate arrays:
+12 bytes per slot, at most 3/4 full.
+
+scan_bulk handles a batch of (flow, chunk) pairs in groups: the table
+slots of the whole group are prefetched, then looked up (prefetching the
+transition row of each flow's state), then the chunks are scanned in order.
+*/
+
+struct FlowState {
+    static constexpr uint32_t FLAG_BITS = 4;
+    static constexpr uint32_t IN_USE = 1u << 0;     // slot taken (set by FlowTable)
+    static constexpr uint32_t STARTED = 1u << 1;    // state is valid; otherwise the start state
+    static constexpr uint32_t MATCHED = 1u << 2;    // some match was reported
+    static constexpr uint32_t FINISHED = 1u << 3;   // dead state or first match seen: skip the rest
+    static constexpr uint32_t MAX_STATES = 1u << (32 - FLAG_BITS);
+
+    uint32_t bits = 0;
+
+    uint32_t dfa_state() const { return bits >> FLAG_BITS; }
+    bool has(uint32_t flag) const { return (bits & flag) != 0; }
+};
+static_assert(sizeof(FlowState) == 4, "per-flow state must stay one word");
+
+class FlowTable {
+public:
+    explicit FlowTable(size_t expected_flows = 1024);
+
+    FlowState* find(uint64_t flow);
+    // New flows start fresh (IN_USE only)
+    FlowState& find_or_insert(uint64_t flow) { return states[find_or_insert_slot(flow)]; }
+    // Ends a flow; false if it was not in the table
+    bool erase(uint64_t flow);
+    // Room for `flows` flows without rehashing
+    void reserve(size_t flows);
+
+    size_t size() const { return count; }
+    size_t size_in_bytes() const { return keys.size() * (sizeof(uint64_t) + sizeof(FlowState)); }
+
+private:
+    friend class FlowMatcher;
+
+    std::vector<uint64_t> keys;
+    std::vector<FlowState> states;       // bits == 0: empty slot
+    size_t mask = 0;
+    size_t count = 0;
+
+    static size_t hash(uint64_t flow);
+    size_t find_or_insert_slot(uint64_t flow);
+    void prefetch(uint64_t flow) const;
+};
+
+struct FlowChunk {
+    uint64_t flow;
+    std::string_view data;
+};
+
+struct FlowMatch {
+    uint64_t flow;
+    uint32_t match_id;   // rule id from the table's match_ids, UINT32_MAX if unlabeled
+    size_t chunk;        // index of the chunk in the batch (0 for scan)
+    size_t end;          // offset in that chunk just after the match
+};
+
+// Per-thread scratch for scan_bulk
+struct FlowScratch {
+    std::vector<size_t> slots;
+};
+
+class FlowMatcher {
+public:
+    // `table` is usually a search table (build_search_table or a rule group);
+    // first_match_only stops each flow after its first match. Returns false
+    // if the table has more states than FlowState can hold.
+    bool build(const DFATable& table, bool first_match_only = false);
+
+    // Continues one flow with its next chunk
+    void scan(FlowState& state, uint64_t flow, std::string_view chunk, std::vector<FlowMatch>* matches) const {
+        scan(state, flow, chunk, 0, matches);
+    }
+    // Continues every flow of the batch, in batch order (a flow may appear
+    // several times); unknown flows are added to the table
+    void scan_bulk(FlowTable& flows, const FlowChunk* chunks, size_t count, FlowScratch& scratch,
+                   std::vector<FlowMatch>& matches) const;
+
+    size_t size_in_bytes() const { return sizeof(*this) + table.memory_bytes(); }
+
+private:
+    DFATable table;
+    bool stop_at_first = false;
+
+    void scan(FlowState& state, uint64_t flow, std::string_view chunk, size_t index,
+              std::vector<FlowMatch>* matches) const;
+    void report(uint32_t state, uint64_t flow, size_t index, size_t end, std::vector<FlowMatch>& matches) const;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "hybrid_automaton.h"
+#include "thompsons_construction.h"
+
+#include <algorithm>
+using namespace std;
+
+/*
+Building the hybrid automaton
+Step 1 - copy the Thompson NFA into arrays; every distinct symbol gets its
+         own byte class, all other bytes share class 0 (no moves)
+         (when every byte is a symbol, class 0 is simply the first of them)
+Step 2 - subset construction as in nfa2dfa.cpp, breadth-first from the
+         start set, but a new subset only becomes a head state while fewer
+         than max_head_states exist. Later subsets are stored as border
+         sets and their transitions are never computed ahead of time.
+
+Scanning
+- in the head: one table lookup per byte
+- past the border: one NFA simulation step per byte on the current set;
+  whenever the set equals a head state the scan switches back to the table
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = 0;
+constexpr uint32_t TAIL_BIT = 1u << 31;
+
+} // namespace
+
+size_t HybridAutomaton::SetHash::operator()(const vector<uint32_t>& set) const {
+    uint64_t h = set.size();
+    for (uint32_t x : set) {
+        h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    return static_cast<size_t>(h);
+}
+
+void HybridAutomaton::step(const vector<uint32_t>& from, uint8_t c, vector<uint32_t>& to,
+                           vector<uint32_t>& marks, uint32_t& generation) const {
+    ++generation;
+    to.clear();
+    auto add = [&](uint32_t s) {
+        if (marks[s] != generation) {
+            marks[s] = generation;
+            to.push_back(s);
+        }
+    };
+
+    for (uint32_t s : from) {
+        for (const auto& [symbol_class, target] : moves[s]) {
+            if (symbol_class == c) add(target);
+        }
+    }
+    if (is_unanchored) add(nfa_start);
+
+    // ε-closure, using `to` itself as the work list
+    for (size_t i = 0; i < to.size(); ++i) {
+        for (uint32_t target : epsilon[to[i]]) add(target);
+    }
+    sort(to.begin(), to.end());
+}
+
+void HybridAutomaton::build(const TreeNode* root, size_t max_head_states, bool unanchored) {
+    *this = HybridAutomaton();
+    is_unanchored = unanchored;
+    max_head_states = max<size_t>(max_head_states, 1);
+
+    // Step 1: NFA in arrays
+    NFA nfa = build_nfa_from_syntax_tree(root);
+    unordered_map<const NFAState*, uint32_t> number;
+    vector<const NFAState*> order;
+    auto index_of = [&](const shared_ptr<NFAState>& state) {
+        auto [it, inserted] = number.emplace(state.get(), static_cast<uint32_t>(order.size()));
+        if (inserted) order.push_back(state.get());
+        return it->second;
+    };
+    nfa_start = index_of(nfa.start_state);
+    nfa_accept = index_of(nfa.accept_state);
+
+    array<bool, 256> used{};
+    size_t num_used = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& [symbol, targets] : order[i]->transitions) {
+            if (!used[static_cast<unsigned char>(symbol)]) {
+                used[static_cast<unsigned char>(symbol)] = true;
+                ++num_used;
+            }
+            for (const auto& target : targets) index_of(target);
+        }
+        for (const auto& target : order[i]->epsilon) index_of(target);
+    }
+    // With all 256 bytes in use no byte lacks moves and class 0 is needed for one of them
+    num_classes = num_used == 256 ? 0 : 1;
+    for (size_t byte = 0; byte < 256; ++byte) {
+        if (used[byte]) byte_class[byte] = static_cast<uint8_t>(num_classes++);
+    }
+    epsilon.resize(order.size());
+    moves.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& [symbol, targets] : order[i]->transitions) {
+            for (const auto& target : targets) {
+                moves[i].emplace_back(byte_class[static_cast<unsigned char>(symbol)], number[target.get()]);
+            }
+        }
+        for (const auto& target : order[i]->epsilon) {
+            epsilon[i].push_back(number[target.get()]);
+        }
+    }
+
+    // Step 2: bounded subset construction
+    vector<uint32_t> marks(order.size(), 0);
+    uint32_t generation = 0;
+    vector<vector<uint32_t>> subsets{{}};  // subsets[0] = dead state
+    unordered_map<vector<uint32_t>, uint32_t, SetHash> tail_ids;
+
+    auto state_for = [&](vector<uint32_t>& subset) -> uint32_t {
+        if (subset.empty()) return DEAD;
+        auto head = head_ids.find(subset);
+        if (head != head_ids.end()) return head->second;
+        if (subsets.size() < max_head_states + 1) {
+            uint32_t id = static_cast<uint32_t>(subsets.size());
+            head_ids.emplace(subset, id);
+            subsets.push_back(subset);
+            return id;
+        }
+        auto [tail, inserted] = tail_ids.emplace(subset, static_cast<uint32_t>(tail_sets.size()));
+        if (inserted) tail_sets.push_back(subset);
+        return TAIL_BIT | tail->second;
+    };
+
+    // The start set is the ε-closure of the NFA start state
+    vector<uint32_t> subset{nfa_start};
+    marks[nfa_start] = ++generation;
+    for (size_t i = 0; i < subset.size(); ++i) {
+        for (uint32_t target : epsilon[subset[i]]) {
+            if (marks[target] != generation) {
+                marks[target] = generation;
+                subset.push_back(target);
+            }
+        }
+    }
+    sort(subset.begin(), subset.end());
+    start = state_for(subset);
+
+    transitions.assign(num_classes, DEAD);  // row of the dead state
+    accepting.assign(1, 0);
+    for (size_t i = 1; i < subsets.size(); ++i) {
+        accepting.push_back(binary_search(subsets[i].begin(), subsets[i].end(), nfa_accept) ? 1 : 0);
+        for (uint32_t c = 0; c < num_classes; ++c) {
+            step(subsets[i], static_cast<uint8_t>(c), subset, marks, generation);
+            transitions.push_back(state_for(subset));
+        }
+    }
+}
+
+template <typename OnAccept>
+void HybridAutomaton::scan(string_view input, ScanStats* stats, OnAccept on_accept) const {
+    if (accepting.size() <= 1) return;  // not built, or the empty language
+    uint32_t state = start;
+    if (accepting[state] && !on_accept(0)) return;
+
+    bool in_tail = false;
+    vector<uint32_t> current, next, marks;
+    uint32_t generation = 0;
+    size_t processed = 0;
+    size_t tail_bytes = 0;
+    for (size_t i = 0; i < input.size(); ++i) {
+        ++processed;
+        uint8_t c = byte_class[static_cast<unsigned char>(input[i])];
+        if (!in_tail) {
+            uint32_t target = transitions[static_cast<size_t>(state) * num_classes + c];
+            if (target == DEAD) break;
+            if (!(target & TAIL_BIT)) {
+                state = target;
+                if (accepting[state] && !on_accept(i + 1)) break;
+                continue;
+            }
+            // Crossed the border
+            current = tail_sets[target & ~TAIL_BIT];
+            in_tail = true;
+        } else {
+            if (marks.empty()) marks.assign(moves.size(), 0);
+            step(current, c, next, marks, generation);
+            current.swap(next);
+            ++tail_bytes;
+            if (current.empty()) break;
+            auto head = head_ids.find(current);
+            if (head != head_ids.end()) {
+                in_tail = false;
+                state = head->second;
+                if (accepting[state] && !on_accept(i + 1)) break;
+                continue;
+            }
+        }
+        if (binary_search(current.begin(), current.end(), nfa_accept) && !on_accept(i + 1)) break;
+    }
+
+    if (stats) {
+        stats->head_bytes += processed - tail_bytes;
+        stats->tail_bytes += tail_bytes;
+    }
+}
+
+bool HybridAutomaton::matches(string_view input, ScanStats* stats) const {
+    bool at_end = false;
+    scan(input, stats, [&](size_t end) {
+        at_end = end == input.size();
+        return true;
+    });
+    return at_end;
+}
+
+bool HybridAutomaton::find_first(string_view input, size_t& match_end, ScanStats* stats) const {
+    bool found = false;
+    scan(input, stats, [&](size_t end) {
+        found = true;
+        match_end = end;
+        return false;
+    });
+    return found;
+}
+
+size_t HybridAutomaton::count_match_ends(string_view input, ScanStats* stats) const {
+    size_t count = 0;
+    scan(input, stats, [&](size_t) {
+        ++count;
+        return true;
+    });
+    return count;
+}
+
+size_t HybridAutomaton::size_in_bytes() const {
+    size_t bytes = sizeof(*this)
+                 + transitions.size() * sizeof(uint32_t)
+                 + accepting.size();
+    for (const auto& set : tail_sets) bytes += sizeof(set) + set.size() * sizeof(uint32_t);
+    // head_ids keeps a copy of every head set
+    for (const auto& [set, id] : head_ids) bytes += sizeof(set) + set.size() * sizeof(uint32_t) + sizeof(id);
+    for (size_t s = 0; s < moves.size(); ++s) {
+        bytes += epsilon[s].size() * sizeof(uint32_t) + moves[s].size() * sizeof(moves[s][0]);
+    }
+    return bytes;
+}
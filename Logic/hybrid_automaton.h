@@ -0,0 +1,75 @@
+#ifndef HYBRID_AUTOMATON_H
+#define HYBRID_AUTOMATON_H
+
+#include "parser.h"
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Hybrid automaton: DFA head, NFA tail
+
+Subset construction runs only until max_head_states DFA states exist.
+Transitions that would need more states point to "border" NFA state sets
+instead. The scanner runs on the DFA table while it stays in the head and
+falls back to NFA simulation when it crosses the border, returning to the
+table as soon as the simulated set is a head state again. Memory stays
+bounded by the head, and input that never gets past the head runs at DFA
+speed.
+
+Anchored: the whole input has to match. Unanchored: a match may start at
+any position (the NFA start state is re-added after every byte).
+*/
+class HybridAutomaton {
+public:
+    struct ScanStats {
+        size_t head_bytes = 0;   // bytes handled by the DFA table
+        size_t tail_bytes = 0;   // bytes handled by NFA simulation
+    };
+
+    void build(const TreeNode* root, size_t max_head_states, bool unanchored);
+
+    // True if the automaton accepts after the whole input (unanchored: the
+    // input ends with a match)
+    bool matches(std::string_view input, ScanStats* stats = nullptr) const;
+    // End of the first match (unanchored: the earliest end of any match)
+    bool find_first(std::string_view input, size_t& match_end, ScanStats* stats = nullptr) const;
+    // Number of input positions where some match ends (position 0 included)
+    size_t count_match_ends(std::string_view input, ScanStats* stats = nullptr) const;
+
+    size_t head_states() const { return accepting.empty() ? 0 : accepting.size() - 1; }
+    size_t border_sets() const { return tail_sets.size(); }
+    size_t size_in_bytes() const;
+
+private:
+    struct SetHash {
+        size_t operator()(const std::vector<uint32_t>& set) const;
+    };
+
+    // ε-NFA in arrays; moves are (byte class, target)
+    std::vector<std::vector<uint32_t>> epsilon;
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>> moves;
+    uint32_t nfa_start = 0;
+    uint32_t nfa_accept = 0;
+    bool is_unanchored = false;
+
+    // Head DFA: state 0 is dead, entries with TAIL_BIT index tail_sets
+    std::array<uint8_t, 256> byte_class{};
+    uint32_t num_classes = 1;
+    uint32_t start = 0;
+    std::vector<uint32_t> transitions;
+    std::vector<uint8_t> accepting;
+    std::unordered_map<std::vector<uint32_t>, uint32_t, SetHash> head_ids;
+    std::vector<std::vector<uint32_t>> tail_sets;
+
+    // NFA states reachable from `from` on byte class c, ε-closed and sorted
+    void step(const std::vector<uint32_t>& from, uint8_t c, std::vector<uint32_t>& to,
+              std::vector<uint32_t>& marks, uint32_t& generation) const;
+    template <typename OnAccept>
+    void scan(std::string_view input, ScanStats* stats, OnAccept on_accept) const;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "incremental_compiler.h"
+#include "thompsons_construction.h"
+#include "nfa2dfa.h"
+#include "dfa_operations.h"
+#include "literal_set.h"
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+// This file memoizes per-subtree automata so that editing a regex only
+// recompiles the parts that changed.
+// Cached fragment = minimized DFA of the subtree (the analysis result).
+// Rebuilding a parent:
+// - a literal set: build_literal_dfa over its words
+// - '|': product construction over the children's cached DFAs, then minimization
+// - '.' and '*':
+//   1. instantiate each child's cached DFA as an NFA region
+//      (DFA transitions copied, accepting states get an ε-edge to one region accept)
+//   2. wire the regions together exactly like Thompson's construction
+//   3. subset construction + minimization of the wired NFA
+
+namespace {
+
+uint64_t mix_hash(uint64_t h, uint64_t value) {
+    h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+    return h;
+}
+
+MinDFA leaf_dfa(const TreeNode* leaf, set<char>& input_symbols) {
+    MinDFA dfa;
+    auto start = make_shared<MinDFAState>(0);
+    dfa.start_state = start;
+    dfa.all_states.insert(start);
+
+    if (leaf->value == EPSILON) {
+        start->is_accepting = true;
+        return dfa;
+    }
+    vector<char> symbols;
+    if (leaf->value == CHAR_CLASS) {
+        expand_char_class(*leaf->char_class, symbols);
+    } else {
+        symbols.push_back(leaf->value);
+    }
+    if (symbols.empty()) return dfa;   // e.g. a negated class of every byte
+
+    auto accept = make_shared<MinDFAState>(1);
+    accept->is_accepting = true;
+    for (char symbol : symbols) {
+        start->transitions[symbol] = accept;
+        input_symbols.insert(symbol);
+    }
+    dfa.all_states.insert(accept);
+    return dfa;
+}
+
+// A cached DFA copied into the NFA being built, with a single accept state
+NFA instantiate_region(const MinDFA& dfa) {
+    map<const MinDFAState*, shared_ptr<NFAState>> states;
+    for (const auto& state : dfa.all_states) {
+        states[state.get()] = create_state();
+    }
+
+    NFA region;
+    region.start_state = states[dfa.start_state.get()];
+    region.accept_state = create_state();
+
+    for (const auto& state : dfa.all_states) {
+        auto& nfa_state = states[state.get()];
+        for (const auto& [symbol, next_state] : state->transitions) {
+            nfa_state->transitions[symbol].push_back(states[next_state.get()]);
+        }
+        if (state->is_accepting) {
+            nfa_state->epsilon.push_back(region.accept_state);
+        }
+    }
+    return region;
+}
+
+} // namespace
+
+IncrementalCompiler::IncrementalCompiler(size_t max_cached_fragments)
+    : max_cached_fragments(max_cached_fragments) {}
+
+bool IncrementalCompiler::Shape::operator==(const Shape& other) const {
+    return op == other.op && operands == other.operands && negated == other.negated && ranges == other.ranges &&
+           words == other.words;
+}
+
+size_t IncrementalCompiler::ShapeHash::operator()(const Shape& shape) const {
+    uint64_t h = mix_hash(static_cast<unsigned char>(shape.op), shape.operands.size());
+    for (uint64_t id : shape.operands) h = mix_hash(h, id);
+    h = mix_hash(h, shape.negated);
+    for (const auto& [low, high] : shape.ranges) h = mix_hash(mix_hash(h, low), high);
+    for (const string& word : shape.words) {
+        h = mix_hash(h, word.size());
+        for (char symbol : word) h = mix_hash(h, static_cast<unsigned char>(symbol));
+    }
+    return static_cast<size_t>(h);
+}
+
+MinDFA IncrementalCompiler::compile(const SyntaxTree& tree) {
+    ++generation;
+    stats = IncrementalStats();
+    if (!tree.root) return MinDFA();
+
+    MinDFA result = build(tree.root).dfa;
+    evict_unused();
+    return result;
+}
+
+/*
+Fragment of a subtree, children first: a subtree's shape names its
+children by fragment id, so it is known only once they are.
+'|' and '.' chains use their flattened operands, so (a|b)|c and a|(b|c)
+share fragments; alternatives are sorted and deduplicated because their
+order and repetition do not change the language.
+Plain strings never get fragments of their own: the strings of a chain
+are one literal set, so editing a word of a keyword list rebuilds only
+that set (and the chain, if it has other alternatives).
+*/
+const IncrementalCompiler::Fragment& IncrementalCompiler::build(const TreeNode* node) {
+    if (node->value == '|' || node->value == '.') {
+        vector<string> words;
+        if (extract_literal_words(node, words)) return literal_set(move(words));
+
+        vector<const TreeNode*> chain;
+        flatten_chain(node, node->value, chain);
+        vector<const Fragment*> operands;
+        for (const TreeNode* operand : chain) {
+            if (node->value == '|' && extract_literal_words(operand, words)) continue;
+            operands.push_back(&build(operand));
+        }
+        if (!words.empty()) operands.push_back(&literal_set(move(words)));
+        if (node->value == '|') {
+            auto by_id = [](const Fragment* a, const Fragment* b) { return a->id < b->id; };
+            sort(operands.begin(), operands.end(), by_id);
+            operands.erase(unique(operands.begin(), operands.end()), operands.end());
+            if (operands.size() == 1) return *operands[0];   // a|a is a
+        }
+        Shape shape;
+        shape.op = node->value;
+        for (const Fragment* operand : operands) shape.operands.push_back(operand->id);
+        return find_or_wire(shape, node->value, operands);
+    }
+    if (node->value == '*') {
+        vector<const Fragment*> parts{&build(node->left)};
+        Shape shape;
+        shape.op = '*';
+        shape.operands.push_back(parts[0]->id);
+        return find_or_wire(shape, '*', parts);
+    }
+
+    // Leaf: symbol, class or ε
+    Shape shape;
+    shape.op = node->value;
+    if (node->value == CHAR_CLASS) {
+        shape.negated = node->char_class->negated;
+        shape.ranges = node->char_class->ranges;
+    }
+    auto [slot, inserted] = cache.try_emplace(move(shape));
+    Fragment& fragment = slot->second;
+    if (inserted) {
+        fragment.id = next_id++;
+        fragment.dfa = leaf_dfa(node, fragment.input_symbols);
+        ++stats.fragments_built;
+    } else {
+        ++stats.fragments_reused;
+    }
+    fragment.last_used = generation;
+    return fragment;
+}
+
+const IncrementalCompiler::Fragment& IncrementalCompiler::literal_set(vector<string> words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    Shape shape;
+    shape.op = '|';
+    shape.words = move(words);
+    auto [slot, inserted] = cache.try_emplace(move(shape));
+    Fragment& fragment = slot->second;
+    if (inserted) {
+        fragment.id = next_id++;
+        fragment.dfa = build_literal_dfa(slot->first.words);
+        fragment.input_symbols = collect_input_symbols(fragment.dfa);
+        ++stats.fragments_built;
+    } else {
+        ++stats.fragments_reused;
+    }
+    fragment.last_used = generation;
+    return fragment;
+}
+
+const IncrementalCompiler::Fragment& IncrementalCompiler::find_or_wire(Shape& shape, char op,
+                                                                       const vector<const Fragment*>& parts) {
+    auto cached = cache.find(shape);
+    if (cached != cache.end()) {
+        cached->second.last_used = generation;
+        ++stats.fragments_reused;
+        return cached->second;
+    }
+
+    Fragment fragment;
+    for (const Fragment* part : parts) {
+        fragment.input_symbols.insert(part->input_symbols.begin(), part->input_symbols.end());
+    }
+    if (op == '|') {
+        vector<const MinDFA*> dfas;
+        for (const Fragment* part : parts) dfas.push_back(&part->dfa);
+        return store(shape, fragment, union_dfa(dfas));
+    }
+
+    vector<NFA> regions;
+    for (const Fragment* part : parts) {
+        regions.push_back(instantiate_region(part->dfa));
+    }
+
+    // Thompson wiring over the regions
+    NFA nfa;
+    if (op == '.') {
+        for (size_t i = 0; i + 1 < regions.size(); ++i) {
+            regions[i].accept_state->epsilon.push_back(regions[i + 1].start_state);
+        }
+        nfa.start_state = regions.front().start_state;
+        nfa.accept_state = regions.back().accept_state;
+    } else { // '*'
+        nfa.start_state = create_state();
+        nfa.accept_state = create_state();
+        nfa.start_state->epsilon.push_back(regions[0].start_state);
+        regions[0].accept_state->epsilon.push_back(nfa.accept_state);
+        nfa.start_state->epsilon.push_back(nfa.accept_state);
+        regions[0].accept_state->epsilon.push_back(regions[0].start_state);
+    }
+    nfa.accept_state->is_accepting = true;
+
+    return store(shape, fragment, nfa_to_dfa(nfa, fragment.input_symbols, false));
+}
+
+// Minimize a rebuilt parent's DFA and cache it under its shape
+const IncrementalCompiler::Fragment& IncrementalCompiler::store(Shape& shape, Fragment& fragment, const DFA& dfa) {
+    fragment.dfa = minimize_dfa(dfa, fragment.input_symbols);
+    fragment.id = next_id++;
+    fragment.last_used = generation;
+    ++stats.fragments_built;
+
+    Fragment& slot = cache[move(shape)];
+    slot = move(fragment);
+    return slot;
+}
+
+// Drop fragments the latest regex no longer uses once the cache is over its limit.
+// Ids are not reused, so a shape that still names a dropped id can never match again.
+void IncrementalCompiler::evict_unused() {
+    if (cache.size() <= max_cached_fragments) return;
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->second.last_used != generation) {
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
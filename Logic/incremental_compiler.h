@@ -0,0 +1,89 @@
+#ifndef INCREMENTAL_COMPILER_H
+#define INCREMENTAL_COMPILER_H
+
+#include "parser.h"
+#include "minimized_dfa.h"
+#include <unordered_map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Counters for the most recent compile() call
+struct IncrementalStats {
+    size_t fragments_reused = 0;   // subtrees answered from the cache
+    size_t fragments_built = 0;    // subtrees determinized and minimized
+};
+
+/*
+Recompiles a regex that changes a little at a time (e.g. on every keystroke).
+
+Every subtree is keyed by its shape: its operator and the ids of its
+operand fragments, or a leaf's symbols. Ids are handed out once and never
+reused, so a cache hit is an exact structural match, not a hash match.
+Chains of '|' and '.' are flattened into one n-ary node, so an edit
+rebuilds the changed operand and each chain above it, not every binary
+node on the way up.
+
+A changed parent is built from its children's cached DFAs:
+- plain-string alternatives of a '|' chain (and a '.' chain that is one
+  string) are pooled into a literal set keyed by its words and built
+  directly by build_literal_dfa, as compile_min_dfa does
+- '|' takes the product of the operand DFAs (union_dfa), which follows
+  them in lockstep without ε-closures
+- '.' and '*' wire the operands with Thompson's ε-transitions and run
+  subset construction over the wired NFA
+and the result is minimized.
+*/
+class IncrementalCompiler {
+public:
+    explicit IncrementalCompiler(size_t max_cached_fragments = 4096);
+
+    // Minimized DFA for the tree, reusing cached fragments of unchanged subtrees
+    MinDFA compile(const SyntaxTree& tree);
+
+    const IncrementalStats& last_stats() const { return stats; }
+    size_t cached_fragments() const { return cache.size(); }
+    void clear() { cache.clear(); }
+
+private:
+    // Operator ('|', '.', '*' or a leaf value) with the ids of its operands
+    // ('|' operands sorted and deduplicated), a class leaf's symbols, or the
+    // sorted words of a literal set ('|' with no operands)
+    struct Shape {
+        char op = 0;
+        std::vector<uint64_t> operands;
+        bool negated = false;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<std::string> words;
+
+        bool operator==(const Shape& other) const;
+    };
+    struct ShapeHash {
+        size_t operator()(const Shape& shape) const;
+    };
+
+    struct Fragment {
+        uint64_t id = 0;
+        MinDFA dfa;
+        set<char> input_symbols;
+        uint64_t last_used = 0;
+    };
+
+    size_t max_cached_fragments;
+    uint64_t generation = 0;
+    uint64_t next_id = 0;
+    IncrementalStats stats;
+    // References stay valid while the map grows; only evict_unused erases
+    std::unordered_map<Shape, Fragment, ShapeHash> cache;
+
+    const Fragment& build(const TreeNode* node);
+    const Fragment& literal_set(std::vector<std::string> words);
+    // Cached fragment for the shape, or `parts` wired together with `op` and stored
+    const Fragment& find_or_wire(Shape& shape, char op, const std::vector<const Fragment*>& parts);
+    const Fragment& store(Shape& shape, Fragment& fragment, const DFA& dfa);
+    void evict_unused();
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "lexer.h"
+#include "compiler.h"
+
+#include <algorithm>
+#include <string>
+using namespace std;
+
+/*
+Building the lexer
+Step 1 - compile every rule to a table whose accepting states carry the
+         rule's index (its priority) as match id
+Step 2 - union the tables in rule order, minimizing after each step; the
+         minimizer keeps states with different labels apart
+Step 3 - resolve priorities: an accepting state keeps only its lowest rule
+         index. States that now win for the same rule are equivalent, so the
+         table is minimized once more.
+
+Backing up to the last accept makes tokenizing quadratic in the worst case
+(e.g. rules "a" and "a*b" on "aaaa..."), as in every maximal-munch scanner;
+typical token grammars back up by a few bytes at most.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = DFATable::DEAD_STATE;
+
+} // namespace
+
+bool Lexer::build(const RuleSet& rule_set, vector<RuleError>& errors, size_t max_states) {
+    *this = Lexer();
+
+    // Step 1 & 2
+    DFATable merged;
+    for (size_t i = 0; i < rule_set.rules.size(); ++i) {
+        const Rule& rule = rule_set.rules[i];
+        DFATable table = build_dfa_table(compile_min_dfa(rule.tree.root), static_cast<uint32_t>(i));
+        token_ids.push_back(rule.id);
+        if (i == 0) {
+            merged = move(table);
+            continue;
+        }
+        DFATable both;
+        if (union_dfa_tables(merged, table, max_states, &both) == 0) {
+            errors.push_back({rule.line, 0, "lexer automaton exceeds " + to_string(max_states) + " states"});
+            *this = Lexer();
+            return false;
+        }
+        merged = minimize_dfa_table(both);
+    }
+    if (rule_set.rules.empty()) return true;
+
+    // Step 3
+    for (auto& ids : merged.match_ids) {
+        if (ids.size() > 1) ids.assign(1, *min_element(ids.begin(), ids.end()));
+    }
+    table = minimize_dfa_table(merged);
+    state_rule.assign(table.num_states, NO_RULE);
+    for (uint32_t s = 0; s < table.num_states; ++s) {
+        if (table.accepting[s] && !table.match_ids[s].empty()) state_rule[s] = table.match_ids[s].front();
+    }
+    return true;
+}
+
+bool Lexer::tokenize(string_view input, vector<Token>& tokens) const {
+    bool ok = true;
+    size_t pos = 0;
+    while (pos < input.size()) {
+        uint32_t rule = NO_RULE;
+        size_t end = pos;
+        if (!state_rule.empty()) {
+            uint32_t state = table.start;
+            for (size_t i = pos; i < input.size(); ++i) {
+                state = table.next(state, static_cast<unsigned char>(input[i]));
+                if (state == DEAD) break;
+                if (state_rule[state] != NO_RULE) {
+                    rule = state_rule[state];
+                    end = i + 1;
+                }
+            }
+        }
+
+        if (rule == NO_RULE) {
+            tokens.push_back({ERROR_TOKEN, pos, pos + 1});
+            ok = false;
+            ++pos;
+        } else {
+            tokens.push_back({token_ids[rule], pos, end});
+            pos = end;
+        }
+    }
+    return ok;
+}
+
+size_t Lexer::size_in_bytes() const {
+    return sizeof(*this) + table.memory_bytes()
+         + state_rule.size() * sizeof(uint32_t)
+         + token_ids.size() * sizeof(unsigned);
+}
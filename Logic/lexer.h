@@ -0,0 +1,52 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "dfa_table.h"
+#include "rule_loader.h"
+#include <vector>
+#include <string_view>
+#include <climits>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Maximal-munch tokenizer generated from an ordered rule list.
+
+Each rule is "<token id>:<regex>" (see rule_loader.h); earlier rules have
+higher priority. All rules go into one union DFA in which every accepting
+state is labeled with the winning rule, so tokenizing is a single pass:
+- the longest prefix matched by any rule becomes the next token,
+- on equal length the earliest rule wins,
+- the scanner runs until the dead state and backs up to the last accept.
+*/
+
+struct Token {
+    unsigned id;       // token id of the rule, or Lexer::ERROR_TOKEN
+    size_t begin;
+    size_t end;
+};
+
+class Lexer {
+public:
+    // One unmatched byte; scanning resumes after it
+    static constexpr unsigned ERROR_TOKEN = UINT_MAX;
+
+    // Returns false (and fills errors) if the union DFA exceeds max_states
+    bool build(const RuleSet& rule_set, std::vector<RuleError>& errors, size_t max_states = 1 << 18);
+
+    // Appends the tokens of the whole input; false if it contains error tokens.
+    // Rules that match the empty string never produce empty tokens.
+    bool tokenize(std::string_view input, std::vector<Token>& tokens) const;
+
+    uint32_t num_states() const { return table.num_states; }
+    size_t size_in_bytes() const;
+
+private:
+    static constexpr uint32_t NO_RULE = UINT32_MAX;
+
+    DFATable table;
+    std::vector<uint32_t> state_rule;    // winning rule index per state, or NO_RULE
+    std::vector<unsigned> token_ids;     // per rule index
+};
+
+#endif
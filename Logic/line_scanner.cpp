@@ -0,0 +1,88 @@
+#include "line_scanner.h"
+#include "compiler.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LINE_SCANNER_SSE2 1
+#endif
+
+using namespace std;
+
+namespace {
+
+// First '\n' in [p, end), or end
+const char* find_newline(const char* p, const char* end) {
+#ifdef LINE_SCANNER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    const void* found = memchr(p, '\n', static_cast<size_t>(end - p));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+} // namespace
+
+bool LineScanner::build(const TreeNode* root, size_t max_states) {
+    DFATable table;
+    if (!build_search_table(build_dfa_table(compile_min_dfa(root)), table, max_states)) return false;
+    search = minimize_dfa_table(table);
+    return true;
+}
+
+size_t LineScanner::count_matching_lines(string_view input) const {
+    LineStream stream(*this);
+    stream.feed(input);
+    stream.finish();
+    return stream.matching_lines();
+}
+
+size_t LineScanner::find_matching_lines(string_view input, vector<LineMatch>& matches) const {
+    LineStream stream(*this);
+    stream.feed(input, &matches);
+    stream.finish(&matches);
+    return stream.matching_lines();
+}
+
+LineStream::LineStream(const LineScanner& scanner)
+    : search(scanner.search), state(scanner.search.start),
+      line_matched(scanner.search.accepting[scanner.search.start] != 0) {}
+
+void LineStream::end_line(size_t end, vector<LineMatch>* matches) {
+    if (line_matched) {
+        ++matched_lines;
+        if (matches) matches->push_back({line_number, line_begin, end});
+    }
+    ++line_number;
+    line_begin = end + 1;
+    state = search.start;
+    line_matched = search.accepting[state] != 0;
+}
+
+void LineStream::feed(string_view chunk, vector<LineMatch>* matches) {
+    const char* p = chunk.data();
+    const char* end = p + chunk.size();
+    while (p < end) {
+        const char* newline = find_newline(p, end);
+
+        // The rest of a matched line is skipped; otherwise run the DFA up to
+        // the newline or the first accept
+        for (; !line_matched && p < newline; ++p) {
+            state = search.next(state, static_cast<unsigned char>(*p));
+            line_matched = search.accepting[state] != 0;
+        }
+        if (newline == end) break;
+        end_line(offset + static_cast<size_t>(newline - chunk.data()), matches);
+        p = newline + 1;
+    }
+    offset += chunk.size();
+}
+
+void LineStream::finish(vector<LineMatch>* matches) {
+    if (offset > line_begin) end_line(offset, matches);
+}
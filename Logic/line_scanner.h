@@ -0,0 +1,70 @@
+#ifndef LINE_SCANNER_H
+#define LINE_SCANNER_H
+
+#include "dfa_table.h"
+#include "parser.h"
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Line-oriented scanning (grep -c / grep -n)
+
+The input is split at '\n' (SSE2, 16 bytes per compare) and each line is
+scanned with the search DFA of the regex, reset at the line start. A line
+matches if the regex matches anywhere in it, and the line is left as soon
+as the DFA accepts. The newline itself is never fed to the DFA.
+
+LineStream keeps the DFA state and line counters between chunks, so a
+line may cross any number of chunk boundaries. A last line without '\n'
+counts once finish() is called.
+*/
+
+struct LineMatch {
+    size_t line_number;   // 1-based
+    size_t begin;         // offset of the line in the whole input
+    size_t end;           // offset of its '\n' (or the end of the input)
+};
+
+class LineScanner {
+public:
+    // Returns false if the search DFA would exceed max_states states
+    bool build(const TreeNode* root, size_t max_states = 1 << 18);
+
+    // grep -c
+    size_t count_matching_lines(std::string_view input) const;
+    // grep -n: appends the matching lines in order, returns how many
+    size_t find_matching_lines(std::string_view input, std::vector<LineMatch>& matches) const;
+
+private:
+    friend class LineStream;
+    DFATable search;
+};
+
+class LineStream {
+public:
+    explicit LineStream(const LineScanner& scanner);
+
+    // Scans the next chunk; matching lines completed in it are appended to
+    // `matches` unless it is null (counting only)
+    void feed(std::string_view chunk, std::vector<LineMatch>* matches = nullptr);
+    // End of input: completes a last line without '\n'
+    void finish(std::vector<LineMatch>* matches = nullptr);
+
+    size_t lines() const { return line_number - 1; }
+    size_t matching_lines() const { return matched_lines; }
+
+private:
+    const DFATable& search;
+    uint32_t state;
+    bool line_matched;
+    size_t line_number = 1;   // of the line being scanned
+    size_t line_begin = 0;
+    size_t offset = 0;        // of the next chunk in the whole input
+    size_t matched_lines = 0;
+
+    void end_line(size_t end, std::vector<LineMatch>* matches);
+};
+
+#endif
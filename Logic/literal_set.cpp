@@ -0,0 +1,184 @@
+#include "literal_set.h"
+#include "thompsons_construction.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <queue>
+#include <cstdint>
+using namespace std;
+
+/*
+Literal-set fast path
+When a pattern is just word1|word2|...|wordN, Thompson's construction,
+subset construction and minimization are all unnecessary: the minimal DFA
+of a finite word list is an acyclic graph that can be built in one pass
+over the sorted words (Daciuk, Mihov, Watson & Watson, 2000).
+
+For every word in sorted order:
+1. find the longest common prefix with the previous word
+2. the previous word's states after that prefix can never change again:
+   replace each of them (deepest first) by an equivalent registered state,
+   or register it
+3. append fresh states for the rest of the new word
+At the end the path of the last word is minimized the same way.
+Two states are equivalent when they agree on accepting and have the same
+transitions to the same (already unique) states.
+*/
+
+namespace {
+
+constexpr uint32_t NO_STATE = UINT32_MAX;
+
+struct LiteralState {
+    vector<pair<char, uint32_t>> transitions;  // sorted by symbol, words arrive in order
+    bool is_accepting = false;
+};
+
+class LiteralDFABuilder {
+public:
+    LiteralDFABuilder()
+        : registry(64, StateHash{&states}, StateEqual{&states}) {
+        states.emplace_back(); // root
+        path.push_back(0);
+    }
+
+    void add_word(const string& word, const string& previous) {
+        size_t prefix = 0;
+        while (prefix < word.size() && prefix < previous.size() && word[prefix] == previous[prefix]) {
+            ++prefix;
+        }
+        replace_or_register(prefix);
+
+        for (size_t i = prefix; i < word.size(); ++i) {
+            uint32_t next = new_state();
+            states[path.back()].transitions.emplace_back(word[i], next);
+            path.push_back(next);
+        }
+        states[path.back()].is_accepting = true;
+    }
+
+    MinDFA finish() {
+        replace_or_register(0);
+        return to_min_dfa();
+    }
+
+private:
+    // Hash/equality look at the state's content, so the registry stores only ids
+    struct StateHash {
+        const vector<LiteralState>* states;
+        size_t operator()(uint32_t id) const {
+            const LiteralState& s = (*states)[id];
+            uint64_t h = s.is_accepting ? 1 : 0;
+            for (const auto& [symbol, target] : s.transitions) {
+                h = (h ^ (static_cast<uint64_t>(static_cast<unsigned char>(symbol)) << 32 | target))
+                    * 0x9e3779b97f4a7c15ULL;
+                h ^= h >> 29;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+    struct StateEqual {
+        const vector<LiteralState>* states;
+        bool operator()(uint32_t a, uint32_t b) const {
+            const LiteralState& x = (*states)[a];
+            const LiteralState& y = (*states)[b];
+            return x.is_accepting == y.is_accepting && x.transitions == y.transitions;
+        }
+    };
+
+    vector<LiteralState> states;
+    vector<uint32_t> free_states;   // replaced states, reused for new suffixes
+    vector<uint32_t> path;          // states along the most recent word, path[0] = root
+    unordered_set<uint32_t, StateHash, StateEqual> registry;
+
+    uint32_t new_state() {
+        if (!free_states.empty()) {
+            uint32_t id = free_states.back();
+            free_states.pop_back();
+            states[id] = LiteralState();
+            return id;
+        }
+        states.emplace_back();
+        return static_cast<uint32_t>(states.size() - 1);
+    }
+
+    // Minimize the states of the last word deeper than `prefix`
+    void replace_or_register(size_t prefix) {
+        while (path.size() > prefix + 1) {
+            uint32_t child = path.back();
+            path.pop_back();
+            auto [registered, inserted] = registry.insert(child);
+            if (!inserted) {
+                states[path.back()].transitions.back().second = *registered;
+                free_states.push_back(child);
+            }
+        }
+    }
+
+    MinDFA to_min_dfa() {
+        MinDFA dfa;
+        vector<shared_ptr<MinDFAState>> converted(states.size());
+        queue<uint32_t> to_process;
+
+        auto convert = [&](uint32_t id) {
+            if (!converted[id]) {
+                converted[id] = make_shared<MinDFAState>(dfa.all_states.size());
+                converted[id]->is_accepting = states[id].is_accepting;
+                dfa.all_states.insert(converted[id]);
+                to_process.push(id);
+            }
+            return converted[id];
+        };
+
+        dfa.start_state = convert(0);
+        while (!to_process.empty()) {
+            uint32_t id = to_process.front();
+            to_process.pop();
+            for (const auto& [symbol, target] : states[id].transitions) {
+                converted[id]->transitions[symbol] = convert(target);
+            }
+        }
+        return dfa;
+    }
+};
+
+} // namespace
+
+bool extract_literal_words(const TreeNode* root, vector<string>& words) {
+    if (!root) return false;
+
+    vector<const TreeNode*> branches;
+    flatten_chain(root, '|', branches);
+
+    vector<string> found;
+    vector<const TreeNode*> symbols;
+    for (const TreeNode* branch : branches) {
+        symbols.clear();
+        flatten_chain(branch, '.', symbols);
+
+        string word;
+        for (const TreeNode* symbol : symbols) {
+            if (symbol->left || symbol->right) return false; // '*' or a nested group
+            if (symbol->value == CHAR_CLASS) return false;
+            if (symbol->value != EPSILON) {
+                word += symbol->value;
+            }
+        }
+        found.push_back(move(word));
+    }
+
+    words.insert(words.end(), make_move_iterator(found.begin()), make_move_iterator(found.end()));
+    return true;
+}
+
+MinDFA build_literal_dfa(vector<string> words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    LiteralDFABuilder builder;
+    string empty;
+    for (size_t i = 0; i < words.size(); ++i) {
+        builder.add_word(words[i], i > 0 ? words[i - 1] : empty);
+    }
+    return builder.finish();
+}
@@ -0,0 +1,18 @@
+#ifndef LITERAL_SET_H
+#define LITERAL_SET_H
+
+#include "parser.h"
+#include "minimized_dfa.h"
+#include <string>
+#include <vector>
+
+// Append the words of a pure literal alternation (e.g. abc|ab|x or a whole
+// keyword list) to `words`. Returns false, leaving `words` untouched, if any
+// branch is more than a plain string.
+bool extract_literal_words(const TreeNode* root, std::vector<std::string>& words);
+
+// Minimal DFA accepting exactly `words`, built directly with the incremental
+// construction for sorted data of Daciuk et al. (no NFA, no partition refinement)
+MinDFA build_literal_dfa(std::vector<std::string> words);
+
+#endif
@@ -1,15 +1,66 @@
-#include "postfix.h"
+#include "parser.h"
 #include "thompsons_construction.h"
 #include "nfa2dfa.h"
 #include "minimized_dfa.h"
+#include "rule_loader.h"
+#include "rule_set_compiler.h"
+#include "lexer.h"
+#include "substitution.h"
+#include "line_scanner.h"
+#include "tree_scanner.h"
+#include "async_reader.h"
+#include "flow_matcher.h"
+#include "tcp_reassembler.h"
 #include <iostream>
 #include <fstream>
 #include <set>
 #include <functional>
 #include <algorithm>
+#include <cstdlib>
+#include <iterator>
 
 using namespace std;
 
+// Text for a JSON string: '"' and '\\' are escaped, control bytes and bytes
+// that are not part of a UTF-8 sequence (a class or an escape can name any
+// byte) become \u00XX; UTF-8 text such as "ε" is kept as it is
+string json_escape(const string& text) {
+    static const char HEX[] = "0123456789abcdef";
+    auto continuation = [&](size_t i) {
+        return i < text.size() && (static_cast<unsigned char>(text[i]) & 0xC0) == 0x80;
+    };
+    string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char byte = static_cast<unsigned char>(text[i]);
+        size_t length = byte >= 0xC2 && byte <= 0xDF ? 2 : byte >= 0xE0 && byte <= 0xEF ? 3 : byte >= 0xF0 && byte <= 0xF4 ? 4 : 1;
+        bool sequence = length > 1;
+        for (size_t k = 1; k < length && sequence; ++k) sequence = continuation(i + k);
+        if (sequence) {
+            out.append(text, i, length);
+            i += length - 1;
+        } else if (byte == '"' || byte == '\\') {
+            out += '\\';
+            out += static_cast<char>(byte);
+        } else if (byte < 0x20 || byte >= 0x7F) {
+            out += "\\u00";
+            out += HEX[byte >> 4];
+            out += HEX[byte & 15];
+        } else {
+            out += static_cast<char>(byte);
+        }
+    }
+    return out;
+}
+
+// Transition label: printable ASCII as itself, any other byte in the regex
+// escape form (\x00, \x1f, \x80) so NUL and bytes >= 0x80 stay visible
+string symbol_label(char symbol) {
+    static const char HEX[] = "0123456789abcdef";
+    unsigned char byte = static_cast<unsigned char>(symbol);
+    if (byte > 0x20 && byte < 0x7F) return string(1, symbol);
+    return string("\\x") + HEX[byte >> 4] + HEX[byte & 15];
+}
+
 // Function to export to JSON
 void export_nfa_to_json(const NFA& nfa, const string& filename) {
     ofstream file(filename);
@@ -33,6 +84,9 @@ void export_nfa_to_json(const NFA& nfa, const string& filename) {
                 collect(next);
             }
         }
+        for (const auto& next : state->epsilon) {
+            collect(next);
+        }
     };
     collect(nfa.start_state);
     
@@ -51,24 +105,23 @@ void export_nfa_to_json(const NFA& nfa, const string& filename) {
     
     // Write transitions
     bool first_transition = true;
+    auto write_transition = [&](int from, int to, const string& symbol) {
+        if (!first_transition) file << ",\n";
+        first_transition = false;
+
+        file << "    {\"from\": " << from
+             << ", \"to\": " << to
+             << ", \"symbol\": \"" << json_escape(symbol) << "\"}";
+    };
     for (const auto& state : all_states) {
         for (const auto& [symbol, next_states] : state->transitions) {
             for (const auto& next : next_states) {
-                if (!first_transition) file << ",\n";
-                first_transition = false;
-                
-                file << "    {\"from\": " << state->id 
-                     << ", \"to\": " << next->id 
-                     << ", \"symbol\": \"";
-                
-                if (symbol == EPSILON) {
-                    file << "ε";
-                } else {
-                    file << symbol;
-                }
-                file << "\"}";
+                write_transition(state->id, next->id, symbol_label(symbol));
             }
         }
+        for (const auto& next : state->epsilon) {
+            write_transition(state->id, next->id, "ε");
+        }
     }
     
     file << "\n  ]\n";
@@ -77,7 +130,7 @@ void export_nfa_to_json(const NFA& nfa, const string& filename) {
     file.close();
 }
 
-void export_syntax_tree_to_json(const shared_ptr<TreeNode>& root, 
+void export_syntax_tree_to_json(const TreeNode* root, 
                                 const string& original_regex,
                                 const string& regex_with_concat,
                                 const string& postfix,
@@ -89,14 +142,14 @@ void export_syntax_tree_to_json(const shared_ptr<TreeNode>& root,
     }
 
     file << "{\n";
-    file << "  \"original_regex\": \"" << original_regex << "\",\n";
-    file << "  \"regex_with_concat\": \"" << regex_with_concat << "\",\n";
-    file << "  \"postfix\": \"" << postfix << "\",\n";
+    file << "  \"original_regex\": \"" << json_escape(original_regex) << "\",\n";
+    file << "  \"regex_with_concat\": \"" << json_escape(regex_with_concat) << "\",\n";
+    file << "  \"postfix\": \"" << json_escape(postfix) << "\",\n";
     file << "  \"root\": ";
     
     // Recursive function to write tree nodes
     int node_id_counter = 0;
-    function<void(const shared_ptr<TreeNode>&)> write_node = [&](const shared_ptr<TreeNode>& node) {
+    function<void(const TreeNode*)> write_node = [&](const TreeNode* node) {
         if (!node) {
             file << "null";
             return;
@@ -107,8 +160,10 @@ void export_syntax_tree_to_json(const shared_ptr<TreeNode>& root,
         file << "    \"value\": \"";
         if (node->value == EPSILON) {
             file << "ε";
+        } else if (node->value == CHAR_CLASS) {
+            file << json_escape(node->char_class->text);
         } else {
-            file << node->value;
+            file << json_escape(string(1, node->value));
         }
         file << "\"";
         
@@ -172,7 +227,7 @@ void export_dfa_to_json(const DFA& dfa, const string& filename) {
             
             file << "    {\"from\": " << state->id 
                  << ", \"to\": " << next_state->id 
-                 << ", \"symbol\": \"" << symbol << "\"}";
+                 << ", \"symbol\": \"" << json_escape(symbol_label(symbol)) << "\"}";
         }
     }
     
@@ -223,7 +278,7 @@ void export_min_dfa_to_json(const MinDFA& min_dfa, const string& filename) {
             
             file << "    {\"from\": " << state->id 
                  << ", \"to\": " << next_state->id 
-                 << ", \"symbol\": \"" << symbol << "\"}";
+                 << ", \"symbol\": \"" << json_escape(symbol_label(symbol)) << "\"}";
         }
     }
     
@@ -233,29 +288,315 @@ void export_min_dfa_to_json(const MinDFA& min_dfa, const string& filename) {
     file.close();
 }
 
-int main() {
+// Load a rule file and report what was parsed
+int run_rule_file(const string& filename) {
+    RuleSet rule_set;
+    bool loaded = load_rule_file(filename, rule_set);
+    for (const auto& error : rule_set.errors) {
+        cerr << filename << ":" << error.line << ":" << error.position + 1 << ": " << error.message << endl;
+    }
+    if (!loaded) return 1;
+
+    cout << "Loaded " << rule_set.rules.size() << " rules, " << rule_set.errors.size() << " errors." << endl;
+    return rule_set.errors.empty() ? 0 : 1;
+}
+
+// Split a rule file into scan groups and print their sizes
+int run_rule_grouping(const string& filename, size_t max_groups) {
+    RuleSet rule_set;
+    if (!load_rule_file(filename, rule_set) || !rule_set.errors.empty()) {
+        return run_rule_file(filename);
+    }
+
+    RuleGroupingOptions options;
+    options.max_groups = max_groups;
+    RuleGrouping grouping = group_rules(rule_set, options);
+    for (const auto& error : grouping.errors) {
+        cerr << filename << ":" << error.line << ": " << error.message << endl;
+    }
+
+    for (size_t i = 0; i < grouping.groups.size(); ++i) {
+        const RuleGroup& group = grouping.groups[i];
+        cout << "Group " << i + 1 << ": " << group.rule_ids.size() << " rules, "
+             << group.table.num_states << " states, " << group.table.memory_bytes() << " bytes, "
+             << group.bytes_per_second / 1e6 << " MB/s"
+             << (group.over_budget ? " (over budget)" : "") << endl;
+    }
+    cout << "Total: " << grouping.groups.size() << " passes, " << grouping.total_states() << " states, "
+         << grouping.memory_bytes() << " bytes, " << grouping.bytes_per_second() / 1e6 << " MB/s" << endl;
+    return grouping.errors.empty() ? 0 : 1;
+}
+
+int run_lexer(const string& rule_file, const string& input_file) {
+    RuleSet rule_set;
+    if (!load_rule_file(rule_file, rule_set) || !rule_set.errors.empty()) {
+        return run_rule_file(rule_file);
+    }
+    ifstream in(input_file, ios::binary);
+    if (!in) {
+        cerr << "Error: cannot read " << input_file << endl;
+        return 1;
+    }
+    string input((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    Lexer lexer;
+    vector<RuleError> errors;
+    if (!lexer.build(rule_set, errors)) {
+        for (const auto& error : errors) {
+            cerr << rule_file << ":" << error.line << ": " << error.message << endl;
+        }
+        return 1;
+    }
+
+    // One token per line: offsets, token id (or "error") and the matched text
+    vector<Token> tokens;
+    bool ok = lexer.tokenize(input, tokens);
+    for (const Token& token : tokens) {
+        cout << token.begin << "-" << token.end << " ";
+        if (token.id == Lexer::ERROR_TOKEN) cout << "error"; else cout << token.id;
+        cout << " " << input.substr(token.begin, token.end - token.begin) << "\n";
+    }
+    cerr << tokens.size() << " tokens, " << lexer.num_states() << " states" << endl;
+    return ok ? 0 : 1;
+}
+
+int run_substitution(const string& regex, const string& replacement, const string& input_file) {
+    SyntaxTree tree;
+    ParseError error;
+    if (!parse_regex(regex, tree, error)) {
+        cerr << "Error: " << error.message << " at position " << error.position << endl;
+        return 1;
+    }
+    Substituter substituter;
+    if (!substituter.build(tree, replacement, error)) {
+        cerr << "Error in replacement: " << error.message << " at position " << error.position << endl;
+        return 1;
+    }
+    ifstream in(input_file, ios::binary);
+    if (!in) {
+        cerr << "Error: cannot read " << input_file << endl;
+        return 1;
+    }
+    string input((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    StreamSink sink(cout);
+    size_t replaced = substituter.replace_all(input, sink);
+    cout.flush();
+    cerr << replaced << " replacements" << endl;
+    return 0;
+}
+
+// Reads the file (or stdin for "-") through AsyncReader, so reading overlaps
+// scanning; a line split across chunks is carried in `pending` so it can
+// still be printed whole
+int run_grep(const string& mode, const string& regex, const string& input_file) {
+    SyntaxTree tree;
+    ParseError error;
+    if (!parse_regex(regex, tree, error)) {
+        cerr << "Error: " << error.message << " at position " << error.position << endl;
+        return 1;
+    }
+    LineScanner scanner;
+    if (!scanner.build(tree.root)) {
+        cerr << "Error: search automaton too large" << endl;
+        return 1;
+    }
+
+    const bool count_only = mode == "-c";
+    const bool numbered = mode == "-n";
+    LineStream stream(scanner);
+    vector<LineMatch> matches;
+    string pending;          // start of the current line, from earlier chunks
+    size_t chunk_offset = 0;
+    auto print = [&](string_view chunk) {
+        for (const LineMatch& match : matches) {
+            if (numbered) cout << match.line_number << ':';
+            if (match.begin < chunk_offset) cout << pending;
+            size_t from = max(match.begin, chunk_offset) - chunk_offset;
+            cout << chunk.substr(from, match.end - chunk_offset - from) << '\n';
+        }
+        matches.clear();
+    };
+    auto on_chunk = [&](string_view chunk) {
+        stream.feed(chunk, count_only ? nullptr : &matches);
+        if (!count_only) {
+            print(chunk);
+            size_t last_newline = chunk.rfind('\n');
+            if (last_newline != string_view::npos) pending.clear();
+            pending.append(chunk.substr(last_newline == string_view::npos ? 0 : last_newline + 1));
+        }
+        chunk_offset += chunk.size();
+    };
+    AsyncReader reader;
+    if (!(input_file == "-" ? reader.read_fd(0, on_chunk) : reader.read_file(input_file, on_chunk))) {
+        cerr << "Error: cannot read " << input_file << endl;
+        return 1;
+    }
+    stream.finish(count_only ? nullptr : &matches);
+    print(string_view());
+    if (count_only) cout << stream.matching_lines() << endl;
+    return 0;
+}
+
+int run_tree_grep(const string& mode, const string& regex, const string& path) {
+    SyntaxTree tree;
+    ParseError error;
+    if (!parse_regex(regex, tree, error)) {
+        cerr << "Error: " << error.message << " at position " << error.position << endl;
+        return 1;
+    }
+    LineScanner scanner;
+    if (!scanner.build(tree.root)) {
+        cerr << "Error: search automaton too large" << endl;
+        return 1;
+    }
+
+    TreeScanOptions options;
+    options.collect_matches = mode != "-c";
+    options.collect_text = options.collect_matches;
+    TreeScanResult result;
+    if (!TreeScanner(scanner).scan(path, options, result)) {
+        cerr << "Error: cannot read " << path << endl;
+        return 1;
+    }
+    for (const string& file : result.unreadable) {
+        cerr << "Error: cannot read " << file << endl;
+    }
+    if (mode == "-c") {
+        for (size_t f = 0; f < result.files.size(); ++f) {
+            cout << result.files[f] << ':' << result.matching_lines[f] << '\n';
+        }
+    }
+    for (const FileLineMatch& match : result.matches) {
+        cout << result.files[match.file] << ':';
+        if (mode == "-n") cout << match.line.line_number << ':';
+        cout << match.text << '\n';
+    }
+    return 0;
+}
+
+// Rules are grouped as for --group-rules; every TCP stream keeps one
+// FlowState per group, reset when the reassembler skips a hole
+int run_pcap_scan(const string& rule_file, const string& capture_file) {
+    RuleSet rule_set;
+    if (!load_rule_file(rule_file, rule_set) || !rule_set.errors.empty()) {
+        return run_rule_file(rule_file);
+    }
+    RuleGrouping grouping = group_rules(rule_set);
+    for (const auto& error : grouping.errors) {
+        cerr << rule_file << ":" << error.line << ": " << error.message << endl;
+    }
+    if (!grouping.errors.empty()) return 1;
+    vector<FlowMatcher> matchers(grouping.groups.size());
+    for (size_t g = 0; g < matchers.size(); ++g) {
+        if (!matchers[g].build(grouping.groups[g].table)) {
+            cerr << "Error: rule group " << g << " has too many states" << endl;
+            return 1;
+        }
+    }
+
+    vector<vector<FlowState>> states;   // per stream, per group
+    vector<uint64_t> scanned;           // per stream: end of the data scanned
+    vector<FlowMatch> matches;
+    size_t total_matches = 0;
+    TcpReassembler reassembler([&](size_t stream, const FlowTuple& tuple, uint64_t offset, string_view data) {
+        if (stream >= states.size()) {
+            states.resize(stream + 1, vector<FlowState>(matchers.size()));
+            scanned.resize(stream + 1, 0);
+        }
+        if (offset != scanned[stream]) {
+            fill(states[stream].begin(), states[stream].end(), FlowState());
+        }
+        scanned[stream] = offset + data.size();
+        for (size_t g = 0; g < matchers.size(); ++g) {
+            matches.clear();
+            matchers[g].scan(states[stream][g], stream, data, &matches);
+            for (const FlowMatch& match : matches) {
+                cout << "rule " << match.match_id << " " << tuple.source_string() << " -> "
+                     << tuple.destination_string() << " end " << offset + match.end << "\n";
+            }
+            total_matches += matches.size();
+        }
+    });
+
+    CaptureReader reader;
+    string error;
+    if (!reader.open(capture_file, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    CapturedPacket packet;
+    TcpSegment segment;
+    size_t packets = 0, segments = 0;
+    while (reader.next(packet)) {
+        ++packets;
+        if (decode_tcp(packet.link_type, packet.data, segment)) {
+            ++segments;
+            reassembler.add(segment);
+        }
+    }
+    reassembler.flush();
+    if (!reader.error().empty()) {
+        cerr << "Warning: " << capture_file << ": " << reader.error() << " after " << packets << " packets" << endl;
+    }
+    cerr << packets << " packets, " << segments << " TCP segments, " << reassembler.num_streams()
+         << " streams, " << total_matches << " matches" << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // MyApp --rules <file> parses a whole rule file instead of one interactive regex
+    if (argc == 3 && string(argv[1]) == "--rules") {
+        return run_rule_file(argv[2]);
+    }
+    // MyApp --group-rules <file> [k] splits it into at most k scan groups
+    if ((argc == 3 || argc == 4) && string(argv[1]) == "--group-rules") {
+        return run_rule_grouping(argv[2], argc == 4 ? strtoul(argv[3], nullptr, 10) : 0);
+    }
+    // MyApp --lex <rule file> <input file> tokenizes the input, rules in priority order
+    if (argc == 4 && string(argv[1]) == "--lex") {
+        return run_lexer(argv[2], argv[3]);
+    }
+    // MyApp --replace <regex> <replacement> <input file> writes the substituted input to stdout
+    if (argc == 5 && string(argv[1]) == "--replace") {
+        return run_substitution(argv[2], argv[3], argv[4]);
+    }
+    // MyApp --grep [-c|-n] <regex> <input file or -> prints the matching lines (-c: count, -n: numbered)
+    if ((argc == 4 || (argc == 5 && (string(argv[2]) == "-c" || string(argv[2]) == "-n"))) && string(argv[1]) == "--grep") {
+        return run_grep(argc == 5 ? argv[2] : "", argv[argc - 2], argv[argc - 1]);
+    }
+    // MyApp --pcap <rule file> <capture file> matches the rules against reassembled TCP streams
+    if (argc == 4 && string(argv[1]) == "--pcap") {
+        return run_pcap_scan(argv[2], argv[3]);
+    }
+    // MyApp --grep-tree [-c|-n] <regex> <directory> scans every file below it on all cores
+    if ((argc == 4 || (argc == 5 && (string(argv[2]) == "-c" || string(argv[2]) == "-n"))) && string(argv[1]) == "--grep-tree") {
+        return run_tree_grep(argc == 5 ? argv[2] : "", argv[argc - 2], argv[argc - 1]);
+    }
+
     // Output directory for JSON files (can be changed to "../../../Visualize/" for CMake builds)
     string output_dir = "../../../Visualize/";  // Write to Visualize directory
     
     string regex = receive_regex_input();
-    string regex_with_concat = insert_concatenation(regex);
-    cout << "Regex with explicit concatenation: " << regex_with_concat << endl;
-
-    string postfix = to_postfix(regex_with_concat);
-    cout << "Postfix expression: " << postfix << endl;
 
-    // pass all the information to build_syntax_tree for display
-    auto syntax_tree_root = build_syntax_tree(postfix, regex, regex_with_concat);
-    cout << "Syntax tree built successfully." << endl;
-
-    if (!syntax_tree_root) {
-        cout << "Error: Failed to build syntax tree." << endl;
+    SyntaxTree syntax_tree;
+    ParseError parse_error;
+    if (!parse_regex(regex, syntax_tree, parse_error)) {
+        cout << "Error: " << parse_error.message << " at position " << parse_error.position << endl;
+        cout << "  " << regex << "\n  " << string(parse_error.position, ' ') << "^" << endl;
         return 1;
     }
+    cout << "Syntax tree built successfully." << endl;
+
+    string regex_with_concat = tree_to_infix(syntax_tree.root);
+    cout << "Regex with explicit concatenation: " << regex_with_concat << endl;
+
+    string postfix = tree_to_postfix(syntax_tree.root);
+    cout << "Postfix expression: " << postfix << endl;
 
-    export_syntax_tree_to_json(syntax_tree_root, regex, regex_with_concat, postfix, output_dir + "syntax_tree.json");
+    export_syntax_tree_to_json(syntax_tree.root, regex, regex_with_concat, postfix, output_dir + "syntax_tree.json");
 
-    NFA nfa = build_nfa_from_syntax_tree(syntax_tree_root);
+    NFA nfa = build_nfa_from_syntax_tree(syntax_tree.root);
     if (!nfa.start_state) {
         cout << "Error: Failed to build NFA." << endl;
         return 1;
@@ -266,23 +607,7 @@ int main() {
     export_nfa_to_json(nfa, output_dir + "nfa.json");
 
     // Collect input symbols from the NFA transitions
-    set<char> input_symbols;
-    function<void(shared_ptr<NFAState>)> collect_symbols = [&](shared_ptr<NFAState> state) {
-        if (state == nullptr) return;
-        static set<shared_ptr<NFAState>> visited;
-        if (visited.find(state) != visited.end()) return;
-        visited.insert(state);
-        
-        for (const auto& [symbol, states] : state->transitions) {
-            if (symbol != EPSILON) {
-                input_symbols.insert(symbol);
-            }
-            for (const auto& next_state : states) {
-                collect_symbols(next_state);
-            }
-        }
-    };
-    collect_symbols(nfa.start_state);
+    set<char> input_symbols = collect_input_symbols(nfa);
 
     // Convert NFA to DFA
     DFA dfa = nfa_to_dfa(nfa, input_symbols);
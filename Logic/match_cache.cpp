@@ -0,0 +1,182 @@
+#include "match_cache.h"
+
+#include <cstring>
+#include <random>
+using namespace std;
+
+namespace {
+
+uint64_t finish_hash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t random_seed() {
+    random_device device;
+    return static_cast<uint64_t>(device()) << 32 ^ device();
+}
+
+} // namespace
+
+MatchCache::MatchCache(size_t capacity, size_t min_input_size) : min_size(min_input_size) {
+    size_t num_buckets = 1;
+    while (num_buckets * WAYS < capacity) num_buckets *= 2;
+    buckets.reset(new Bucket[num_buckets]);
+    hands.reset(new atomic<uint8_t>[num_buckets]);
+    for (size_t b = 0; b < num_buckets; ++b) hands[b].store(0, memory_order_relaxed);
+    mask = num_buckets - 1;
+    seed[0] = random_seed();
+    seed[1] = random_seed();
+    counters.reset(new CounterShard[COUNTER_SHARDS]);
+}
+
+// Two independent multiply-xorshift chains over 8-byte words, keyed by the
+// seeds; both cover the length and the version
+MatchCache::Fingerprint MatchCache::fingerprint(string_view input, uint64_t version) const {
+    uint64_t a = seed[0] ^ (version * 0x9e3779b97f4a7c15ULL);
+    uint64_t b = seed[1] ^ (input.size() * 0xc2b2ae3d27d4eb4fULL) ^ version;
+    const char* p = input.data();
+    size_t n = input.size();
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        a = (a ^ word) * 0x9e3779b97f4a7c15ULL;
+        a ^= a >> 29;
+        b = (b + word) * 0xff51afd7ed558ccdULL;
+        b ^= b >> 32;
+    }
+    if (n) {
+        uint64_t word = 0;
+        memcpy(&word, p, n);
+        a = (a ^ word) * 0x9e3779b97f4a7c15ULL;
+        b = (b + word) * 0xff51afd7ed558ccdULL;
+    }
+    uint64_t check = finish_hash(b ^ input.size());
+    return {finish_hash(a ^ input.size()), check ? check : 1};
+}
+
+/*
+Seqlock read: sequence (acquire), fields, fence (acquire), sequence again.
+An odd or changed sequence means a writer was in the entry: count a miss
+rather than wait for it.
+*/
+bool MatchCache::lookup(const Fingerprint& fp, uint64_t& result) const {
+    Bucket& bucket = buckets[fp.key & mask];
+    for (Entry& entry : bucket.ways) {
+        uint32_t before = entry.sequence.load(memory_order_acquire);
+        if (before & 1) continue;
+        uint64_t key = entry.key.load(memory_order_relaxed);
+        uint64_t check = entry.check.load(memory_order_relaxed);
+        uint64_t value = entry.value.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (entry.sequence.load(memory_order_relaxed) != before) continue;
+        if (key != fp.key || check != fp.check) continue;
+
+        if (!entry.referenced.load(memory_order_relaxed)) entry.referenced.store(1, memory_order_relaxed);
+        result = value;
+        shard().hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    shard().misses.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+/*
+Insert
+Step 1 - Victim: an entry with the same fingerprint, else an empty entry,
+         else CLOCK from the bucket's hand (a set reference bit is cleared
+         and the entry skipped; two rounds always find one)
+Step 2 - Claim it (even -> odd sequence by CAS; give up if held), write the
+         fields, release it (sequence + 2)
+*/
+void MatchCache::insert(const Fingerprint& fp, uint64_t result) {
+    const size_t b = fp.key & mask;
+    Bucket& bucket = buckets[b];
+
+    // Step 1
+    Entry* victim = nullptr;
+    for (Entry& entry : bucket.ways) {
+        uint64_t check = entry.check.load(memory_order_relaxed);
+        if (check == fp.check && entry.key.load(memory_order_relaxed) == fp.key) {
+            victim = &entry;
+            break;
+        }
+        if (!victim && check == 0) victim = &entry;
+    }
+    if (!victim) {
+        size_t hand = hands[b].load(memory_order_relaxed);
+        for (size_t step = 0; step < 2 * WAYS; ++step) {
+            size_t way = (hand + step) % WAYS;
+            Entry& entry = bucket.ways[way];
+            if (entry.referenced.load(memory_order_relaxed)) {
+                entry.referenced.store(0, memory_order_relaxed);
+                continue;
+            }
+            victim = &entry;
+            hands[b].store(static_cast<uint8_t>((way + 1) % WAYS), memory_order_relaxed);
+            break;
+        }
+        if (!victim) victim = &bucket.ways[hand % WAYS];   // every bit was set again meanwhile
+    }
+
+    // Step 2
+    CounterShard& counts = shard();
+    uint32_t sequence = victim->sequence.load(memory_order_relaxed);
+    if ((sequence & 1)
+        || !victim->sequence.compare_exchange_strong(sequence, sequence + 1, memory_order_acquire, memory_order_relaxed)) {
+        counts.dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    uint64_t old_check = victim->check.load(memory_order_relaxed);
+    bool evicts = old_check != 0 && (old_check != fp.check || victim->key.load(memory_order_relaxed) != fp.key);
+    victim->key.store(fp.key, memory_order_relaxed);
+    victim->check.store(fp.check, memory_order_relaxed);
+    victim->value.store(result, memory_order_relaxed);
+    victim->referenced.store(0, memory_order_relaxed);
+    victim->sequence.store(sequence + 2, memory_order_release);
+
+    counts.inserts.fetch_add(1, memory_order_relaxed);
+    if (evicts) counts.evictions.fetch_add(1, memory_order_relaxed);
+}
+
+void MatchCache::count_bypass() {
+    shard().bypassed.fetch_add(1, memory_order_relaxed);
+}
+
+MatchCache::CounterShard& MatchCache::shard() const {
+    static atomic<size_t> next_thread{0};
+    thread_local size_t index = next_thread.fetch_add(1, memory_order_relaxed) % COUNTER_SHARDS;
+    return counters[index];
+}
+
+MatchCacheStats MatchCache::stats() const {
+    MatchCacheStats total;
+    for (size_t s = 0; s < COUNTER_SHARDS; ++s) {
+        const CounterShard& c = counters[s];
+        total.hits += c.hits.load(memory_order_relaxed);
+        total.misses += c.misses.load(memory_order_relaxed);
+        total.inserts += c.inserts.load(memory_order_relaxed);
+        total.evictions += c.evictions.load(memory_order_relaxed);
+        total.dropped += c.dropped.load(memory_order_relaxed);
+        total.bypassed += c.bypassed.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+void MatchCache::reset_stats() {
+    for (size_t s = 0; s < COUNTER_SHARDS; ++s) {
+        CounterShard& c = counters[s];
+        for (atomic<uint64_t>* counter : {&c.hits, &c.misses, &c.inserts, &c.evictions, &c.dropped, &c.bypassed}) {
+            counter->store(0, memory_order_relaxed);
+        }
+    }
+}
+
+size_t MatchCache::size_in_bytes() const {
+    return sizeof(*this) + (mask + 1) * (sizeof(Bucket) + sizeof(atomic<uint8_t>)) + COUNTER_SHARDS * sizeof(CounterShard);
+}
@@ -0,0 +1,117 @@
+#ifndef MATCH_CACHE_H
+#define MATCH_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Match-result cache for repeated inputs (user agents, URLs, host names)
+
+Maps (input, pattern-set version) to a 64-bit result chosen by the caller:
+a bool, a rule bitmask, a match end. The input is not stored, only a 128-bit
+fingerprint: two 64-bit hashes under a per-cache random seed, so crafted
+inputs cannot be aimed at a known collision. A new version makes every
+older entry unreachable; they age out through eviction.
+
+The table is fixed-size and set-associative (WAYS entries per bucket) and
+takes no locks:
+- every entry is a seqlock; a reader retries nothing, it takes a torn read
+  (odd or changed sequence) as a miss;
+- a writer claims an entry by moving its sequence from even to odd with a
+  CAS and drops the insert if another writer holds it;
+- eviction is CLOCK within the bucket: hits set the entry's reference bit,
+  the bucket's hand clears set bits and evicts the first clear entry.
+Counters are sharded per thread, so hits do not bounce one cache line
+between cores.
+
+Inputs shorter than min_input_size bypass the cache in get_or_compute:
+scanning them costs about as much as hashing them.
+*/
+
+struct MatchCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;     // inserts that replaced a live entry
+    uint64_t dropped = 0;       // inserts lost to a concurrent writer
+    uint64_t bypassed = 0;      // inputs below min_input_size
+
+    double hit_rate() const { return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0; }
+};
+
+class MatchCache {
+public:
+    static constexpr size_t WAYS = 4;
+
+    // capacity is rounded up to a power-of-two number of buckets
+    explicit MatchCache(size_t capacity = 1 << 16, size_t min_input_size = 16);
+
+    bool lookup(std::string_view input, uint64_t version, uint64_t& result) const {
+        return lookup(fingerprint(input, version), result);
+    }
+    void insert(std::string_view input, uint64_t version, uint64_t result) {
+        insert(fingerprint(input, version), result);
+    }
+
+    // Cached result, or compute(input) stored for next time
+    template <typename Compute>
+    uint64_t get_or_compute(std::string_view input, uint64_t version, Compute compute) {
+        if (input.size() < min_size) {
+            count_bypass();
+            return compute(input);
+        }
+        Fingerprint key = fingerprint(input, version);
+        uint64_t result;
+        if (lookup(key, result)) return result;
+        result = compute(input);
+        insert(key, result);
+        return result;
+    }
+
+    MatchCacheStats stats() const;
+    void reset_stats();
+    size_t capacity() const { return (mask + 1) * WAYS; }
+    size_t size_in_bytes() const;
+
+private:
+    struct Fingerprint {
+        uint64_t key;      // picks the bucket
+        uint64_t check;    // never 0: 0 marks an empty entry
+    };
+
+    struct Entry {
+        std::atomic<uint32_t> sequence{0};   // odd while a writer holds the entry
+        std::atomic<uint8_t> referenced{0};
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> value{0};
+    };
+
+    // Two cache lines, never split between buckets
+    struct alignas(64) Bucket {
+        Entry ways[WAYS];
+    };
+
+    struct alignas(64) CounterShard {
+        std::atomic<uint64_t> hits{0}, misses{0}, inserts{0}, evictions{0}, dropped{0}, bypassed{0};
+    };
+    static constexpr size_t COUNTER_SHARDS = 16;
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::unique_ptr<std::atomic<uint8_t>[]> hands;   // CLOCK hand per bucket
+    size_t mask = 0;                                  // buckets - 1
+    size_t min_size;
+    uint64_t seed[2];
+    mutable std::unique_ptr<CounterShard[]> counters;
+
+    Fingerprint fingerprint(std::string_view input, uint64_t version) const;
+    bool lookup(const Fingerprint& key, uint64_t& result) const;
+    void insert(const Fingerprint& key, uint64_t result);
+    void count_bypass();
+    CounterShard& shard() const;
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include "match_iterator.h"
+#include "compiler.h"
+
+#include <vector>
+
+using namespace std;
+
+/*
+Finding the next match at or after `from`
+Step 1 - run the search table from `from` until it accepts: the earliest
+         position `end` at which any match ends
+Step 2 - run the reverse table from `end` back towards `from`; the last
+         accepting position is the leftmost start `begin` of a match
+         ending at `end` (EARLIEST stops here)
+Step 3 - leftmost-longest: a match may still start before `begin` and end
+         after `end`. The starts in [from, begin) are first tried one by
+         one with the anchored table, which is fastest when failed attempts
+         die after a few bytes. Past a step budget proportional to the gap,
+         all starts run together instead, one thread per start; two threads
+         in the same state have the same future, so only the earlier start
+         is kept. The smallest start that matches wins, otherwise `begin`.
+         The anchored table then runs to its dead state for the longest end.
+
+With the budget, Step 3 stays linear in the bytes it looks at times the
+number of anchored states. The thread sets are per-thread scratch buffers
+that only grow, so iterating does not allocate once they are sized.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = DFATable::DEAD_STATE;
+
+// Anchored steps per byte of [from, begin) before switching to threads
+constexpr size_t STEPS_PER_BYTE = 4;
+constexpr size_t MIN_STEP_BUDGET = 64;
+
+struct Threads {
+    std::vector<size_t> start_of;   // per anchored state, SIZE_MAX if no thread
+    std::vector<size_t> next_start_of;
+    std::vector<uint32_t> live;
+    std::vector<uint32_t> next;
+};
+
+} // namespace
+
+MatchIterator::MatchIterator(const MatchFinder* finder, string_view input, MatchSemantics semantics)
+    : finder(finder), input(input), semantics(semantics) {
+    ++*this;
+}
+
+MatchIterator& MatchIterator::operator++() {
+    if (!finder) return *this;
+    if (!finder->next_match(input, resume, semantics, span)) {
+        finder = nullptr;
+        span = {0, 0};
+        return *this;
+    }
+    resume = span.end == span.begin ? span.end + 1 : span.end;
+    return *this;
+}
+
+bool MatchFinder::build(const TreeNode* root, size_t max_states) {
+    return build(build_dfa_table(compile_min_dfa(root)), max_states);
+}
+
+bool MatchFinder::build(const DFATable& anchored_table, size_t max_states) {
+    *this = MatchFinder();
+    anchored = anchored_table;
+    DFATable table;
+    if (!build_search_table(anchored, table, max_states)) return false;
+    search = minimize_dfa_table(table);
+    if (!build_reverse_table(anchored, table, max_states)) return false;
+    reverse = minimize_dfa_table(table);
+    return true;
+}
+
+size_t MatchFinder::earliest_end(string_view input, size_t from) const {
+    uint32_t state = search.start;
+    if (state == DEAD) return SIZE_MAX;
+    if (search.accepting[state]) return from;
+    for (size_t i = from; i < input.size(); ++i) {
+        state = search.next(state, static_cast<unsigned char>(input[i]));
+        if (search.accepting[state]) return i + 1;
+    }
+    return SIZE_MAX;
+}
+
+size_t MatchFinder::longest_end(string_view input, size_t begin) const {
+    uint32_t state = anchored.start;
+    if (state == DEAD) return SIZE_MAX;
+    size_t end = anchored.accepting[state] ? begin : SIZE_MAX;
+    for (size_t i = begin; i < input.size(); ++i) {
+        state = anchored.next(state, static_cast<unsigned char>(input[i]));
+        if (state == DEAD) break;
+        if (anchored.accepting[state]) end = i + 1;
+    }
+    return end;
+}
+
+bool MatchFinder::next_match(string_view input, size_t from, MatchSemantics semantics, MatchSpan& span) const {
+    if (from > input.size()) return false;
+
+    // Step 1
+    size_t end = earliest_end(input, from);
+    if (end == SIZE_MAX) return false;
+
+    // Step 2
+    size_t begin = end;
+    uint32_t state = reverse.start;
+    for (size_t i = end; i > from; --i) {
+        state = reverse.next(state, static_cast<unsigned char>(input[i - 1]));
+        if (state == DEAD) break;
+        if (reverse.accepting[state]) begin = i - 1;
+    }
+    if (semantics == MatchSemantics::EARLIEST) {
+        span = {begin, end};
+        return true;
+    }
+
+    // Step 3
+    size_t winner = begin;
+    if (begin > from) winner = leftmost_start(input, from, begin);
+    span = {winner, longest_end(input, winner)};
+    return true;
+}
+
+size_t MatchFinder::leftmost_start(string_view input, size_t from, size_t begin) const {
+    size_t budget = (begin - from) * STEPS_PER_BYTE + MIN_STEP_BUDGET;
+    for (size_t start = from; start < begin; ++start) {
+        uint32_t state = anchored.start;
+        for (size_t i = start; i < input.size() && budget > 0; ++i, --budget) {
+            state = anchored.next(state, static_cast<unsigned char>(input[i]));
+            if (state == DEAD) break;
+            if (anchored.accepting[state]) return start;
+        }
+        if (budget == 0) break;
+        from = start + 1;
+    }
+    if (from >= begin) return begin;
+
+    thread_local Threads threads;
+    threads.start_of.assign(anchored.num_states, SIZE_MAX);
+    threads.next_start_of.assign(anchored.num_states, SIZE_MAX);
+    threads.live.clear();
+
+    size_t winner = begin;
+    for (size_t i = from; i < input.size(); ++i) {
+        // New thread for start i, unless an earlier start is in the start state
+        if (i < winner && threads.start_of[anchored.start] == SIZE_MAX) {
+            threads.start_of[anchored.start] = i;
+            threads.live.push_back(anchored.start);
+        }
+        if (threads.live.empty()) break;
+
+        threads.next.clear();
+        for (uint32_t s : threads.live) {
+            size_t start = threads.start_of[s];
+            threads.start_of[s] = SIZE_MAX;
+            uint32_t t = anchored.next(s, static_cast<unsigned char>(input[i]));
+            if (t == DEAD || start >= winner) continue;
+            if (threads.next_start_of[t] == SIZE_MAX) threads.next.push_back(t);
+            if (start < threads.next_start_of[t]) threads.next_start_of[t] = start;
+        }
+        swap(threads.start_of, threads.next_start_of);
+        swap(threads.live, threads.next);
+        for (uint32_t s : threads.live) {
+            if (anchored.accepting[s] && threads.start_of[s] < winner) winner = threads.start_of[s];
+        }
+    }
+    return winner;
+}
+
+size_t MatchFinder::count(string_view input, MatchSemantics semantics) const {
+    size_t total = 0;
+    size_t from = 0;
+    if (semantics == MatchSemantics::EARLIEST) {
+        // A match ending at `from` can only be empty, any later end belongs
+        // to a non-empty match (ε would have matched at `from` already)
+        while (from <= input.size()) {
+            size_t end = earliest_end(input, from);
+            if (end == SIZE_MAX) break;
+            ++total;
+            from = end == from ? end + 1 : end;
+        }
+        return total;
+    }
+
+    MatchSpan span;
+    while (next_match(input, from, semantics, span)) {
+        ++total;
+        from = span.end == span.begin ? span.end + 1 : span.end;
+    }
+    return total;
+}
+
+size_t MatchFinder::size_in_bytes() const {
+    return sizeof(*this) + anchored.memory_bytes() + search.memory_bytes() + reverse.memory_bytes();
+}
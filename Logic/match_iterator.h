@@ -0,0 +1,111 @@
+#ifndef MATCH_ITERATOR_H
+#define MATCH_ITERATOR_H
+
+#include "dfa_table.h"
+#include "parser.h"
+#include <iterator>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Find all non-overlapping matches of one regex in a string_view.
+
+Three tables are built once per regex:
+- the search table (Σ*·L) finds where the next match ends,
+- the reverse table walks back from that end to the leftmost start,
+- the anchored table extends a start to its longest match.
+
+Semantics:
+- LEFTMOST_LONGEST: the match that starts first, and of those the longest
+  (POSIX). For example, `a|ab|abc` on "abcd" gives [0, 3).
+- EARLIEST: a match is reported as soon as it ends, with the leftmost start
+  among matches ending there. The same input gives [0, 1).
+
+The scan resumes at the end of each match. After an empty match it resumes
+one byte later, so a regex that matches ε reports every position.
+Iterating allocates nothing.
+*/
+
+enum class MatchSemantics {
+    LEFTMOST_LONGEST,
+    EARLIEST,
+};
+
+struct MatchSpan {
+    size_t begin;
+    size_t end;
+};
+
+class MatchFinder;
+
+class MatchIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = MatchSpan;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const MatchSpan*;
+    using reference = const MatchSpan&;
+
+    MatchIterator() = default;   // end iterator
+    MatchIterator(const MatchFinder* finder, std::string_view input, MatchSemantics semantics);
+
+    reference operator*() const { return span; }
+    pointer operator->() const { return &span; }
+    MatchIterator& operator++();
+    MatchIterator operator++(int) {
+        MatchIterator old = *this;
+        ++*this;
+        return old;
+    }
+    bool operator==(const MatchIterator& other) const {
+        return finder == other.finder && (!finder || span.begin == other.span.begin);
+    }
+    bool operator!=(const MatchIterator& other) const { return !(*this == other); }
+
+private:
+    const MatchFinder* finder = nullptr;   // nullptr once exhausted
+    std::string_view input;
+    MatchSemantics semantics = MatchSemantics::LEFTMOST_LONGEST;
+    size_t resume = 0;
+    MatchSpan span{0, 0};
+};
+
+struct MatchRange {
+    MatchIterator first;
+    MatchIterator begin() const { return first; }
+    MatchIterator end() const { return MatchIterator(); }
+};
+
+class MatchFinder {
+public:
+    // Returns false if a table would exceed max_states states
+    bool build(const TreeNode* root, size_t max_states = 1 << 18);
+    bool build(const DFATable& anchored_table, size_t max_states = 1 << 18);
+
+    MatchRange find_all(std::string_view input,
+                        MatchSemantics semantics = MatchSemantics::LEFTMOST_LONGEST) const {
+        return {MatchIterator(this, input, semantics)};
+    }
+    // Same count as iterating find_all; EARLIEST only runs the search table
+    size_t count(std::string_view input, MatchSemantics semantics = MatchSemantics::LEFTMOST_LONGEST) const;
+
+    // Next match starting at or after `from`; false if there is none
+    bool next_match(std::string_view input, size_t from, MatchSemantics semantics, MatchSpan& span) const;
+
+    size_t size_in_bytes() const;
+
+private:
+    DFATable anchored;
+    DFATable search;
+    DFATable reverse;
+
+    // End of the first match ending at or after `from`, or SIZE_MAX
+    size_t earliest_end(std::string_view input, size_t from) const;
+    // Longest match starting at `begin`, or SIZE_MAX
+    size_t longest_end(std::string_view input, size_t begin) const;
+    // Smallest start in [from, begin) of any match, or `begin`
+    size_t leftmost_start(std::string_view input, size_t from, size_t begin) const;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <map>
 #include <queue>
 #include <functional>
+#include <unordered_map>
 using namespace std;
 
 /*
@@ -26,15 +27,24 @@ DFA minimization is usually done in three steps:
 // This file minimizes DFA using Hopcroft's algorithm
 // Input: DFA, Output: Minimized DFA
 
-// Helper function to find which partition a state belongs to
-int find_partition(const shared_ptr<DFAState>& state, 
-                   const vector<set<shared_ptr<DFAState>>>& partitions) {
+// state -> index of the partition it belongs to
+using PartitionIndex = unordered_map<const DFAState*, int>;
+
+// Rebuilt after every refinement round so lookups stay O(1)
+PartitionIndex index_partitions(const vector<set<shared_ptr<DFAState>>>& partitions) {
+    PartitionIndex index;
     for (size_t i = 0; i < partitions.size(); ++i) {
-        if (partitions[i].find(state) != partitions[i].end()) {
-            return i;
+        for (const auto& state : partitions[i]) {
+            index[state.get()] = static_cast<int>(i);
         }
     }
-    return -1;
+    return index;
+}
+
+// Helper function to find which partition a state belongs to
+int find_partition(const shared_ptr<DFAState>& state, const PartitionIndex& index) {
+    auto it = index.find(state.get());
+    return it != index.end() ? it->second : -1;
 }
 
 MinDFA minimize_dfa(const DFA& dfa, const set<char>& input_symbols) {
@@ -80,6 +90,7 @@ MinDFA minimize_dfa(const DFA& dfa, const set<char>& input_symbols) {
     while (changed) {
         changed = false;
         vector<set<shared_ptr<DFAState>>> new_partitions;
+        PartitionIndex index = index_partitions(partitions);
         
         for (const auto& partition : partitions) {
             // Try to split this partition
@@ -93,7 +104,7 @@ MinDFA minimize_dfa(const DFA& dfa, const set<char>& input_symbols) {
                     auto it = state->transitions.find(symbol);
                     if (it != state->transitions.end()) {
                         // Direct access to the target state
-                        int target_partition = find_partition(it->second, partitions);
+                        int target_partition = find_partition(it->second, index);
                         signature.push_back(target_partition);
                     } else {
                         signature.push_back(-1); // no transition for this symbol
@@ -119,6 +130,7 @@ MinDFA minimize_dfa(const DFA& dfa, const set<char>& input_symbols) {
     
     // Step 4: Build the minimized DFA
     map<int, shared_ptr<MinDFAState>> partition_to_state;
+    PartitionIndex index = index_partitions(partitions);
     
     // Create a MinDFAState for each partition
     for (size_t i = 0; i < partitions.size(); ++i) {
@@ -142,7 +154,7 @@ MinDFA minimize_dfa(const DFA& dfa, const set<char>& input_symbols) {
         for (char symbol : input_symbols) {
             auto it = representative->transitions.find(symbol);
             if (it != representative->transitions.end()) {
-                int target_partition = find_partition(it->second, partitions);
+                int target_partition = find_partition(it->second, index);
                 if (target_partition != -1) {
                     min_state->transitions[symbol] = partition_to_state[target_partition];
                 }
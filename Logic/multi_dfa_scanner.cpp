@@ -0,0 +1,200 @@
+#include "multi_dfa_scanner.h"
+
+#include <map>
+#include <climits>
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MULTI_DFA_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+Layout
+Step 1 - joint byte classes: two bytes share a class only if they share a
+         class in every table
+Step 2 - global state numbers: global state 0 is a sink for padding lanes,
+         then each table gets a block of numbers, non-accepting states
+         first and accepting states last
+Step 3 - transitions[c * total_states + g] is the next global state of
+         global state g on byte class c
+
+The number of lanes is rounded up to a multiple of 16 so the SIMD loops
+never need a remainder; padding lanes sit in state 0 and never accept.
+*/
+
+namespace {
+
+constexpr size_t LANE_GROUP = 16;
+
+struct Layout {
+    const uint32_t* transitions;
+    const uint8_t* byte_class;
+    uint32_t total_states;
+    size_t lanes;
+    const uint32_t* start_states;
+    const int32_t* thresholds;
+};
+
+template <typename OnAccept>
+void scan_scalar(const Layout& layout, size_t num_tables, string_view input, OnAccept& on_accept) {
+    vector<uint32_t> states(layout.start_states, layout.start_states + num_tables);
+    for (size_t i = 0; i < input.size(); ++i) {
+        const uint32_t* row = layout.transitions
+            + static_cast<size_t>(layout.byte_class[static_cast<unsigned char>(input[i])]) * layout.total_states;
+        for (size_t k = 0; k < num_tables; ++k) {
+            states[k] = row[states[k]];
+            if (static_cast<int32_t>(states[k]) > layout.thresholds[k]) on_accept(k, i + 1);
+        }
+    }
+}
+
+#ifdef MULTI_DFA_X86
+
+template <typename OnAccept>
+__attribute__((target("avx2")))
+void scan_avx2(const Layout& layout, string_view input, OnAccept& on_accept) {
+    vector<uint32_t> states(layout.start_states, layout.start_states + layout.lanes);
+    for (size_t i = 0; i < input.size(); ++i) {
+        const int* row = reinterpret_cast<const int*>(layout.transitions
+            + static_cast<size_t>(layout.byte_class[static_cast<unsigned char>(input[i])]) * layout.total_states);
+        for (size_t g = 0; g < layout.lanes; g += 8) {
+            __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&states[g]));
+            current = _mm256_i32gather_epi32(row, current, 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&states[g]), current);
+            __m256i threshold = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&layout.thresholds[g]));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(current, threshold))));
+            while (mask) {
+                on_accept(g + __builtin_ctz(mask), i + 1);
+                mask &= mask - 1;
+            }
+        }
+    }
+}
+
+template <typename OnAccept>
+__attribute__((target("avx512f")))
+void scan_avx512(const Layout& layout, string_view input, OnAccept& on_accept) {
+    vector<uint32_t> states(layout.start_states, layout.start_states + layout.lanes);
+    for (size_t i = 0; i < input.size(); ++i) {
+        const int* row = reinterpret_cast<const int*>(layout.transitions
+            + static_cast<size_t>(layout.byte_class[static_cast<unsigned char>(input[i])]) * layout.total_states);
+        for (size_t g = 0; g < layout.lanes; g += 16) {
+            __m512i current = _mm512_loadu_si512(&states[g]);
+            // Masked form: every lane is gathered, and the source operand is defined
+            current = _mm512_mask_i32gather_epi32(current, 0xFFFF, current, row, 4);
+            _mm512_storeu_si512(&states[g], current);
+            __m512i threshold = _mm512_loadu_si512(&layout.thresholds[g]);
+            unsigned mask = _mm512_cmpgt_epi32_mask(current, threshold);
+            while (mask) {
+                on_accept(g + __builtin_ctz(mask), i + 1);
+                mask &= mask - 1;
+            }
+        }
+    }
+}
+
+bool has_avx512() { return __builtin_cpu_supports("avx512f"); }
+bool has_avx2() { return __builtin_cpu_supports("avx2"); }
+
+#endif
+
+} // namespace
+
+void MultiDFAScanner::build(const vector<DFATable>& tables) {
+    *this = MultiDFAScanner();
+    num_tables = tables.size();
+
+    // Step 1: joint byte classes
+    map<vector<uint8_t>, uint32_t> classes;
+    vector<vector<uint8_t>> columns;  // joint class -> column in each table
+    vector<uint8_t> key(tables.size());
+    for (int byte = 0; byte < 256; ++byte) {
+        for (size_t k = 0; k < tables.size(); ++k) key[k] = tables[k].byte_class[byte];
+        auto [it, inserted] = classes.emplace(key, static_cast<uint32_t>(classes.size()));
+        if (inserted) columns.push_back(key);
+        byte_class[byte] = static_cast<uint8_t>(it->second);
+    }
+    num_classes = static_cast<uint32_t>(classes.size());
+
+    // Step 2: global numbering, accepting states last
+    size_t lanes = (tables.size() + LANE_GROUP - 1) / LANE_GROUP * LANE_GROUP;
+    start_states.assign(lanes, 0);
+    accept_thresholds.assign(lanes, INT32_MAX);
+    vector<vector<uint32_t>> global(tables.size());
+    uint32_t next_id = 1;
+    for (size_t k = 0; k < tables.size(); ++k) {
+        const DFATable& table = tables[k];
+        global[k].resize(table.num_states);
+        for (int accepting_pass = 0; accepting_pass < 2; ++accepting_pass) {
+            if (accepting_pass) accept_thresholds[k] = static_cast<int32_t>(next_id) - 1;
+            for (uint32_t s = 0; s < table.num_states; ++s) {
+                if ((table.accepting[s] != 0) == (accepting_pass != 0)) global[k][s] = next_id++;
+            }
+        }
+        start_states[k] = global[k][table.start];
+    }
+    total_states = next_id;
+
+    // Step 3: interleaved rows
+    transitions.assign(static_cast<size_t>(num_classes) * total_states, 0);
+    for (uint32_t c = 0; c < num_classes; ++c) {
+        uint32_t* row = &transitions[static_cast<size_t>(c) * total_states];
+        for (size_t k = 0; k < tables.size(); ++k) {
+            const DFATable& table = tables[k];
+            for (uint32_t s = 0; s < table.num_states; ++s) {
+                row[global[k][s]] = global[k][table.transitions[static_cast<size_t>(s) * table.num_classes + columns[c][k]]];
+            }
+        }
+    }
+}
+
+template <typename OnAccept>
+void MultiDFAScanner::run(string_view input, OnAccept on_accept) const {
+    for (size_t k = 0; k < num_tables; ++k) {
+        if (static_cast<int32_t>(start_states[k]) > accept_thresholds[k]) on_accept(k, 0);
+    }
+
+    Layout layout{transitions.data(), byte_class.data(), total_states, start_states.size(),
+                  start_states.data(), accept_thresholds.data()};
+#ifdef MULTI_DFA_X86
+    if (num_tables > 1 && has_avx512()) {
+        scan_avx512(layout, input, on_accept);
+        return;
+    }
+    if (num_tables > 1 && has_avx2()) {
+        scan_avx2(layout, input, on_accept);
+        return;
+    }
+#endif
+    scan_scalar(layout, num_tables, input, on_accept);
+}
+
+void MultiDFAScanner::scan(string_view input, vector<MultiMatch>& matches) const {
+    run(input, [&](size_t k, size_t end) {
+        matches.push_back({static_cast<uint32_t>(k), end});
+    });
+}
+
+void MultiDFAScanner::count_matches(string_view input, vector<size_t>& counts) const {
+    counts.assign(num_tables, 0);
+    run(input, [&](size_t k, size_t) {
+        ++counts[k];
+    });
+}
+
+size_t MultiDFAScanner::size_in_bytes() const {
+    return sizeof(*this)
+         + transitions.size() * sizeof(uint32_t)
+         + start_states.size() * sizeof(uint32_t)
+         + accept_thresholds.size() * sizeof(int32_t);
+}
+
+const char* MultiDFAScanner::kernel_name() const {
+#ifdef MULTI_DFA_X86
+    if (num_tables > 1 && has_avx512()) return "avx512";
+    if (num_tables > 1 && has_avx2()) return "avx2";
+#endif
+    return "scalar";
+}
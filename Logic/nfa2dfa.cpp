@@ -1,6 +1,5 @@
 #include "nfa2dfa.h"
 #include "thompsons_construction.h"
-#include "postfix.h"
 #include <set>
 #include <queue>
 #include <functional>
@@ -10,6 +9,37 @@ using namespace std;
 // Convert NFA to DFA using subset construction algorithm
 // Added debug as well
 
+// Collect the input symbols (all transition labels) of an NFA
+set<char> collect_input_symbols(const NFA& nfa) {
+    set<char> input_symbols;
+    set<shared_ptr<NFAState>> visited;
+    queue<shared_ptr<NFAState>> to_process;
+    if (nfa.start_state) {
+        visited.insert(nfa.start_state);
+        to_process.push(nfa.start_state);
+    }
+
+    while (!to_process.empty()) {
+        auto state = to_process.front();
+        to_process.pop();
+
+        for (const auto& [symbol, next_states] : state->transitions) {
+            input_symbols.insert(symbol);
+            for (const auto& next_state : next_states) {
+                if (visited.insert(next_state).second) {
+                    to_process.push(next_state);
+                }
+            }
+        }
+        for (const auto& next_state : state->epsilon) {
+            if (visited.insert(next_state).second) {
+                to_process.push(next_state);
+            }
+        }
+    }
+    return input_symbols;
+}
+
 // Function to compute epsilon closure of a set of NFA states
 set<shared_ptr<NFAState>> epsilon_closure(const set<shared_ptr<NFAState>>& states) {
     set<shared_ptr<NFAState>> e_closure = states;
@@ -23,13 +53,10 @@ set<shared_ptr<NFAState>> epsilon_closure(const set<shared_ptr<NFAState>>& state
         auto state = to_process.front();
         to_process.pop();
 
-        auto it = state->transitions.find(EPSILON);
-        if (it != state->transitions.end()) {
-            for (const auto& next_state : it->second) {
-                if (e_closure.find(next_state) == e_closure.end()) {
-                    e_closure.insert(next_state);
-                    to_process.push(next_state);
-                }
+        for (const auto& next_state : state->epsilon) {
+            if (e_closure.find(next_state) == e_closure.end()) {
+                e_closure.insert(next_state);
+                to_process.push(next_state);
             }
         }
     }
@@ -37,7 +64,7 @@ set<shared_ptr<NFAState>> epsilon_closure(const set<shared_ptr<NFAState>>& state
     return e_closure;
 }
 
-DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols) {
+DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols, bool print_debug) {
     DFA dfa;
     map<set<shared_ptr<NFAState>>, shared_ptr<DFAState>> state_mapping;
     queue<set<shared_ptr<NFAState>>> to_process;
@@ -46,23 +73,25 @@ DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols) {
     set<shared_ptr<NFAState>> start_set = epsilon_closure({nfa.start_state});
 
     // DEBUG: Print start state composition
-    cout << "\n=== NFA to DFA Conversion Debug ===\n";
-    cout << "Start DFA state (0) contains NFA states: {";
-    for (const auto& s : start_set) {
-        cout << s->id << " ";
-    }
-    cout << "}\n";
-    cout << "Start state is accepting: ";
-    bool start_accepting = false;
-    for (const auto& s : start_set) {
-        if (s->is_accepting) {
-            start_accepting = true;
-            cout << "YES (contains NFA accepting state " << s->id << ")\n";
-            break;
+    if (print_debug) {
+        cout << "\n=== NFA to DFA Conversion Debug ===\n";
+        cout << "Start DFA state (0) contains NFA states: {";
+        for (const auto& s : start_set) {
+            cout << s->id << " ";
+        }
+        cout << "}\n";
+        cout << "Start state is accepting: ";
+        bool start_accepting = false;
+        for (const auto& s : start_set) {
+            if (s->is_accepting) {
+                start_accepting = true;
+                cout << "YES (contains NFA accepting state " << s->id << ")\n";
+                break;
+            }
         }
+        if (!start_accepting) cout << "NO\n";
+        cout << "\n";
     }
-    if (!start_accepting) cout << "NO\n";
-    cout << "\n";
 
     auto dfa_start_state = make_shared<DFAState>(0);
     dfa.start_state = dfa_start_state;
@@ -107,31 +136,31 @@ DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols) {
             }
 
             // DEBUG: Print transition information
-            int next_dfa_id = -1;
-            if (state_mapping.find(next_set) != state_mapping.end()) {
-                next_dfa_id = state_mapping[next_set]->id;
-            } else {
-                next_dfa_id = dfa_state_id_counter;
-            }
-            
-            cout << "DFA state " << current_dfa_state->id 
-                 << " --" << symbol << "--> DFA state " << next_dfa_id
-                 << " (NFA states: {";
-            for (const auto& s : next_set) {
-                cout << s->id << " ";
-            }
-            cout << "}";
-            
-            // Check if accepting
-            bool is_accepting = false;
-            for (const auto& s : next_set) {
-                if (s->is_accepting) {
-                    is_accepting = true;
-                    cout << " - ACCEPTING";
-                    break;
+            if (print_debug) {
+                int next_dfa_id = -1;
+                if (state_mapping.find(next_set) != state_mapping.end()) {
+                    next_dfa_id = state_mapping[next_set]->id;
+                } else {
+                    next_dfa_id = dfa_state_id_counter;
+                }
+
+                cout << "DFA state " << current_dfa_state->id 
+                     << " --" << symbol << "--> DFA state " << next_dfa_id
+                     << " (NFA states: {";
+                for (const auto& s : next_set) {
+                    cout << s->id << " ";
                 }
+                cout << "}";
+
+                // Check if accepting
+                for (const auto& s : next_set) {
+                    if (s->is_accepting) {
+                        cout << " - ACCEPTING";
+                        break;
+                    }
+                }
+                cout << ")\n";
             }
-            cout << ")\n";
 
             // Create new DFA state if needed
             if (state_mapping.find(next_set) == state_mapping.end()) {
@@ -145,7 +174,9 @@ DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols) {
         }
     }
     
-    cout << "\n=== End Debug ===\n\n";
+    if (print_debug) {
+        cout << "\n=== End Debug ===\n\n";
+    }
     
     // Populate all_states
     for (const auto& [nfa_set, dfa_state] : state_mapping) {
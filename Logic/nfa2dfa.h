@@ -34,7 +34,9 @@ struct DFA {
 };
 
 // Functions
+set<char> collect_input_symbols(const NFA& nfa);
 set<shared_ptr<NFAState>> epsilon_closure(const set<shared_ptr<NFAState>>& states);
-DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols);
+// print_debug traces every subset and transition to stdout
+DFA nfa_to_dfa(const NFA& nfa, const set<char>& input_symbols, bool print_debug = true);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,381 @@
+#include "packet_capture.h"
+
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC_MICROSECONDS = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NANOSECONDS = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr uint32_t PCAPNG_OBSOLETE_PACKET = 2;
+constexpr uint32_t PCAPNG_SIMPLE_PACKET = 3;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 6;
+
+// Larger records are taken as a damaged file rather than allocated
+constexpr uint32_t MAX_RECORD_SIZE = 1u << 28;
+
+constexpr uint32_t LINKTYPE_NULL = 0;
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr uint32_t LINKTYPE_RAW = 101;
+constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+constexpr uint32_t LINKTYPE_IPV4 = 228;
+constexpr uint32_t LINKTYPE_IPV6 = 229;
+constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86dd;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+
+constexpr uint8_t IP_PROTOCOL_TCP = 6;
+constexpr uint8_t IPV6_HOP_BY_HOP = 0;
+constexpr uint8_t IPV6_ROUTING = 43;
+constexpr uint8_t IPV6_DESTINATION_OPTIONS = 60;
+
+uint32_t host32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Byte-swapped: a file written with the other byte order
+constexpr uint32_t swap32(uint32_t value) {
+    return value >> 24 | (value >> 8 & 0xff00) | (value << 8 & 0xff0000) | value << 24;
+}
+
+// Network byte order
+uint16_t big16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+uint32_t big32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16
+         | static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+string address_string(uint8_t version, const array<uint8_t, 16>& address, uint16_t port) {
+    string text;
+    if (version == 4) {
+        for (int i = 0; i < 4; ++i) {
+            if (i) text += '.';
+            text += to_string(address[i]);
+        }
+    } else {
+        static const char HEX[] = "0123456789abcdef";
+        text += '[';
+        for (int group = 0; group < 8; ++group) {
+            if (group) text += ':';
+            unsigned value = big16(&address[group * 2]);
+            bool leading = true;
+            for (int shift = 12; shift >= 0; shift -= 4) {
+                unsigned digit = (value >> shift) & 15;
+                if (leading && digit == 0 && shift) continue;
+                leading = false;
+                text += HEX[digit];
+            }
+        }
+        text += ']';
+    }
+    return text + ':' + to_string(port);
+}
+
+} // namespace
+
+bool FlowTuple::operator==(const FlowTuple& other) const {
+    return ip_version == other.ip_version && source == other.source && destination == other.destination
+        && source_port == other.source_port && destination_port == other.destination_port;
+}
+
+string FlowTuple::source_string() const {
+    return address_string(ip_version, source, source_port);
+}
+
+string FlowTuple::destination_string() const {
+    return address_string(ip_version, destination, destination_port);
+}
+
+size_t FlowTupleHash::operator()(const FlowTuple& tuple) const {
+    uint64_t h = tuple.ip_version;
+    auto mix = [&h](uint64_t x) {
+        h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    };
+    for (size_t i = 0; i < 16; i += 8) {
+        uint64_t source, destination;
+        memcpy(&source, &tuple.source[i], 8);
+        memcpy(&destination, &tuple.destination[i], 8);
+        mix(source);
+        mix(destination);
+    }
+    mix(static_cast<uint64_t>(tuple.source_port) << 16 | tuple.destination_port);
+    return static_cast<size_t>(h);
+}
+
+uint16_t CaptureReader::read16(const char* p) const {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return swapped ? static_cast<uint16_t>(value >> 8 | value << 8) : value;
+}
+
+uint32_t CaptureReader::read32(const char* p) const {
+    uint32_t value = host32(p);
+    return swapped ? swap32(value) : value;
+}
+
+bool CaptureReader::open(const string& path, string& error) {
+    *this = CaptureReader();
+    file.open(path, ios::binary);
+    char header[24];
+    if (!file || !file.read(header, 4)) {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    uint32_t magic = host32(header);
+    if (magic == PCAPNG_SECTION_HEADER) {
+        // The section header is read as the first block of the stream
+        file.seekg(0);
+        pcapng = true;
+        return true;
+    }
+    if (magic == PCAP_MAGIC_MICROSECONDS || magic == PCAP_MAGIC_NANOSECONDS) {
+        swapped = false;
+    } else if (magic == swap32(PCAP_MAGIC_MICROSECONDS) || magic == swap32(PCAP_MAGIC_NANOSECONDS)) {
+        swapped = true;
+    } else {
+        error = path + " is not a pcap or pcapng file";
+        return false;
+    }
+    if (!file.read(header + 4, 20)) {
+        error = "truncated pcap header in " + path;
+        return false;
+    }
+    pcap_link_type = read32(header + 20) & 0x0fffffff;   // upper bits hold FCS information
+    return true;
+}
+
+bool CaptureReader::next(CapturedPacket& packet) {
+    last_error.clear();
+    return pcapng ? next_pcapng(packet) : next_pcap(packet);
+}
+
+bool CaptureReader::next_pcap(CapturedPacket& packet) {
+    char header[16];
+    if (!file.read(header, 16)) {
+        if (file.gcount() != 0) last_error = "truncated record header";
+        return false;
+    }
+    uint32_t captured = read32(header + 8);
+    if (captured > MAX_RECORD_SIZE) {
+        last_error = "record of " + to_string(captured) + " bytes";
+        return false;
+    }
+    buffer.resize(captured);
+    if (!file.read(buffer.data(), captured)) {
+        last_error = "truncated record";
+        return false;
+    }
+    packet.link_type = pcap_link_type;
+    packet.data = string_view(buffer.data(), captured);
+    return true;
+}
+
+bool CaptureReader::read_section_header(const char* block, size_t length) {
+    if (length < 28 || read16(block + 12) != 1) {
+        last_error = "unsupported pcapng section";
+        return false;
+    }
+    interfaces.clear();
+    return true;
+}
+
+/*
+pcapng blocks: type, total length, body, total length (all 32-bit).
+A section header is recognized before its byte order is known (its type is
+a palindrome); the byte-order magic that follows sets `swapped` for the
+whole section.
+*/
+bool CaptureReader::next_pcapng(CapturedPacket& packet) {
+    while (true) {
+        char head[12];
+        if (!file.read(head, 8)) {
+            if (file.gcount() != 0) last_error = "truncated block header";
+            return false;
+        }
+        size_t have = 8;
+        bool section = host32(head) == PCAPNG_SECTION_HEADER;
+        if (section) {
+            if (!file.read(head + 8, 4)) {
+                last_error = "truncated section header";
+                return false;
+            }
+            have = 12;
+            uint32_t byte_order = host32(head + 8);
+            if (byte_order != PCAPNG_BYTE_ORDER_MAGIC && byte_order != swap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+                last_error = "bad byte-order magic";
+                return false;
+            }
+            swapped = byte_order != PCAPNG_BYTE_ORDER_MAGIC;
+        }
+
+        uint32_t type = read32(head);
+        uint32_t length = read32(head + 4);
+        if (length < 12 || length % 4 != 0 || length > MAX_RECORD_SIZE || length < have) {
+            last_error = "bad block length " + to_string(length);
+            return false;
+        }
+        buffer.resize(length);
+        memcpy(buffer.data(), head, have);
+        if (!file.read(buffer.data() + have, length - have)) {
+            last_error = "truncated block";
+            return false;
+        }
+        const char* block = buffer.data();
+        const size_t body_end = length - 4;
+
+        if (section) {
+            if (!read_section_header(block, length)) return false;
+        } else if (type == PCAPNG_INTERFACE_DESCRIPTION) {
+            if (length < 20) {
+                last_error = "short interface description";
+                return false;
+            }
+            interfaces.push_back(read16(block + 8));
+        } else if (type == PCAPNG_ENHANCED_PACKET || type == PCAPNG_OBSOLETE_PACKET) {
+            if (length < 32) {
+                last_error = "short packet block";
+                return false;
+            }
+            uint32_t interface = type == PCAPNG_ENHANCED_PACKET ? read32(block + 8) : read16(block + 8);
+            uint32_t captured = read32(block + 20);
+            if (interface >= interfaces.size() || captured > body_end - 28) {
+                last_error = "bad packet block";
+                return false;
+            }
+            packet.link_type = interfaces[interface];
+            packet.data = string_view(block + 28, captured);
+            return true;
+        } else if (type == PCAPNG_SIMPLE_PACKET) {
+            if (length < 16 || interfaces.empty()) {
+                last_error = "bad simple packet block";
+                return false;
+            }
+            uint32_t captured = min<uint32_t>(read32(block + 8), static_cast<uint32_t>(body_end - 12));
+            packet.link_type = interfaces[0];
+            packet.data = string_view(block + 12, captured);
+            return true;
+        }
+        // Any other block (statistics, name resolution, custom ...) is skipped
+    }
+}
+
+/*
+Frame decoding
+Step 1 - Link layer: find the ethertype (or IP version) and the offset of the IP header
+Step 2 - IPv4/IPv6 header, trimmed to the IP length (drops Ethernet padding);
+         the frame must hold the whole datagram
+Step 3 - TCP header and payload
+*/
+bool decode_tcp(uint32_t link_type, string_view frame, TcpSegment& segment) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(frame.data());
+    size_t size = frame.size();
+
+    // Step 1
+    size_t offset = 0;
+    uint16_t ether_type = 0;
+    switch (link_type & 0x0fffffff) {
+    case LINKTYPE_NULL: {
+        if (size < 4) return false;
+        // Address family in the byte order of the capturing host
+        uint32_t family = p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+        if (family > 0xffff) family = big32(p);
+        if (family == 2) ether_type = ETHERTYPE_IPV4;
+        else if (family == 24 || family == 28 || family == 30) ether_type = ETHERTYPE_IPV6;
+        else return false;
+        offset = 4;
+        break;
+    }
+    case LINKTYPE_ETHERNET:
+        if (size < 14) return false;
+        ether_type = big16(p + 12);
+        offset = 14;
+        while (ether_type == ETHERTYPE_VLAN || ether_type == ETHERTYPE_QINQ) {
+            if (size < offset + 4) return false;
+            ether_type = big16(p + offset + 2);
+            offset += 4;
+        }
+        break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        if (size < 1) return false;
+        ether_type = (p[0] >> 4) == 6 ? ETHERTYPE_IPV6 : ETHERTYPE_IPV4;
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (size < 16) return false;
+        ether_type = big16(p + 14);
+        offset = 16;
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (size < 20) return false;
+        ether_type = big16(p);
+        offset = 20;
+        break;
+    default:
+        return false;
+    }
+
+    // Step 2
+    const uint8_t* ip = p + offset;
+    size_t ip_size = size - offset;
+    size_t header = 0;
+    FlowTuple& tuple = segment.tuple;
+    tuple = FlowTuple();
+    if (ether_type == ETHERTYPE_IPV4) {
+        if (ip_size < 20 || (ip[0] >> 4) != 4) return false;
+        header = static_cast<size_t>(ip[0] & 15) * 4;
+        size_t total = big16(ip + 2);
+        if (header < 20 || total < header || total > ip_size) return false;
+        ip_size = total;
+        if ((big16(ip + 6) & 0x3fff) != 0) return false;   // MF flag or fragment offset
+        if (ip[9] != IP_PROTOCOL_TCP) return false;
+        tuple.ip_version = 4;
+        memcpy(tuple.source.data(), ip + 12, 4);
+        memcpy(tuple.destination.data(), ip + 16, 4);
+    } else if (ether_type == ETHERTYPE_IPV6) {
+        if (ip_size < 40 || (ip[0] >> 4) != 6) return false;
+        size_t total = 40 + static_cast<size_t>(big16(ip + 4));
+        if (total > ip_size) return false;
+        ip_size = total;
+        uint8_t next = ip[6];
+        header = 40;
+        while (next == IPV6_HOP_BY_HOP || next == IPV6_ROUTING || next == IPV6_DESTINATION_OPTIONS) {
+            if (ip_size < header + 8) return false;
+            next = ip[header];
+            header += (static_cast<size_t>(ip[header + 1]) + 1) * 8;
+        }
+        if (next != IP_PROTOCOL_TCP || header > ip_size) return false;   // fragments included
+        tuple.ip_version = 6;
+        memcpy(tuple.source.data(), ip + 8, 16);
+        memcpy(tuple.destination.data(), ip + 24, 16);
+    } else {
+        return false;
+    }
+
+    // Step 3
+    const uint8_t* tcp = ip + header;
+    size_t tcp_size = ip_size - header;
+    if (tcp_size < 20) return false;
+    size_t data_offset = static_cast<size_t>(tcp[12] >> 4) * 4;
+    if (data_offset < 20 || data_offset > tcp_size) return false;
+    tuple.source_port = big16(tcp);
+    tuple.destination_port = big16(tcp + 2);
+    segment.sequence = big32(tcp + 4);
+    segment.flags = tcp[13];
+    segment.payload = string_view(reinterpret_cast<const char*>(tcp + data_offset), tcp_size - data_offset);
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Offline packet captures without libpcap
+
+CaptureReader reads classic pcap (microsecond or nanosecond timestamps,
+either byte order) and pcapng (section header, interface description,
+enhanced/simple/obsolete packet blocks; other blocks are skipped) one
+record at a time into a reused buffer.
+
+decode_tcp takes a captured frame down to its TCP segment:
+    link layer   Ethernet (with 802.1Q/802.1ad tags), raw IP, Linux cooked
+                 (SLL, SLL2), BSD loopback
+    network      IPv4 (fragments are skipped), IPv6 (hop-by-hop, routing
+                 and destination options headers are skipped, fragments too)
+Truncated or malformed frames are rejected.
+*/
+
+struct FlowTuple {
+    uint8_t ip_version = 4;
+    std::array<uint8_t, 16> source{};        // IPv4 uses the first 4 bytes
+    std::array<uint8_t, 16> destination{};
+    uint16_t source_port = 0;
+    uint16_t destination_port = 0;
+
+    bool operator==(const FlowTuple& other) const;
+    // "10.0.0.1:80", "[2001:db8:0:0:0:0:0:1]:443"
+    std::string source_string() const;
+    std::string destination_string() const;
+};
+
+struct FlowTupleHash {
+    size_t operator()(const FlowTuple& tuple) const;
+};
+
+struct TcpSegment {
+    static constexpr uint8_t FIN = 0x01;
+    static constexpr uint8_t SYN = 0x02;
+    static constexpr uint8_t RST = 0x04;
+
+    FlowTuple tuple;                 // direction of this segment
+    uint32_t sequence = 0;
+    uint8_t flags = 0;
+    std::string_view payload;        // points into the frame
+};
+
+struct CapturedPacket {
+    uint32_t link_type = 0;          // LINKTYPE_* value
+    std::string_view data;           // captured bytes, valid until the next read
+};
+
+class CaptureReader {
+public:
+    // Reads the file header; false (with `error` set) if the file cannot be
+    // read or is neither pcap nor pcapng
+    bool open(const std::string& path, std::string& error);
+    // Next packet; false at the end of the file or on a damaged record
+    // (then `error` is not empty)
+    bool next(CapturedPacket& packet);
+
+    bool is_pcapng() const { return pcapng; }
+    const std::string& error() const { return last_error; }
+
+private:
+    std::ifstream file;
+    bool pcapng = false;
+    bool swapped = false;                    // file byte order differs from ours
+    uint32_t pcap_link_type = 0;
+    std::vector<uint32_t> interfaces;        // pcapng link types of the current section
+    std::vector<char> buffer;
+    std::string last_error;
+
+    uint16_t read16(const char* p) const;
+    uint32_t read32(const char* p) const;
+    bool next_pcap(CapturedPacket& packet);
+    bool next_pcapng(CapturedPacket& packet);
+    bool read_section_header(const char* block, size_t length);
+};
+
+// False if the frame does not carry a (complete, unfragmented) TCP segment
+bool decode_tcp(uint32_t link_type, std::string_view frame, TcpSegment& segment);
+
+#endif
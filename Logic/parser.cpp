@@ -0,0 +1,400 @@
+#include "parser.h"
+
+#include <iostream>
+#include <string>
+#include <cctype>
+#include <algorithm>
+using namespace std;
+
+// structs and function declarations are in the header (parser.h)
+// function implementations are in this .cpp file
+// This file does:
+// 1. receive regex as input
+// 2. parse the regex into a syntax tree with a single recursive-descent pass
+//    (explicit concatenation, precedence and tree building happen together)
+
+// Next steps are in thompsons_construction.cpp, nfa2dfa.cpp and minimized_dfa.cpp
+
+
+/*
+Step 1 - Receive Regex as Input
+*/
+string receive_regex_input() {
+    string regex;
+    cout << "Enter a regular expression: ";
+    getline(cin, regex);
+    return regex;
+}
+
+
+TreeNode* SyntaxTree::make_node(char value, size_t position, TreeNode* left, TreeNode* right) {
+    nodes.emplace_back(value, position);
+    TreeNode* node = &nodes.back();
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+
+/*
+Step 2 - Recursive-Descent Parser
+Grammar (lowest to highest precedence, same as * > . > |):
+
+    alternation   := concatenation ('|' concatenation)*
+    concatenation := repetition*            (empty → ε)
+    repetition    := atom '*'*
+    atom          := letter | digit | escape | class | '(' alternation ')'
+    class         := '[' '^'? (symbol ('-' symbol)?)+ ']'
+    symbol        := letter | digit | escape
+    escape        := '\x' hex hex | '\x{' hex+ '}'
+
+An escape names any symbol by its code, including 0 (NUL), and becomes a
+one-symbol class, so '\0' stays free to mean ε in the tree. Codes above
+max_symbol are rejected: the byte pipelines stop at 0xFF, token-id
+automata pass a wider alphabet.
+
+Concatenation is implicit: consecutive repetitions are joined with a '.' node,
+so no preprocessed string or postfix string is ever built.
+Binary operators are left-associative, giving the same tree the
+shunting-yard + stack method produced, e.g. a(b|c)*d → ((a.(b|c)*).d).
+*/
+namespace {
+
+// Bound on '(' nesting so hostile input cannot exhaust the call stack
+constexpr size_t MAX_NESTING_DEPTH = 1000;
+
+// \x{...} takes up to 8 hex digits (32-bit token ids)
+constexpr size_t MAX_HEX_DIGITS = 8;
+
+uint32_t hex_value(char digit) {
+    int value = tolower(static_cast<unsigned char>(digit));
+    return static_cast<uint32_t>(isdigit(value) ? value - '0' : value - 'a' + 10);
+}
+
+// Leaf value for the empty string
+constexpr char EPSILON = '\0';
+
+class Parser {
+public:
+    Parser(const string& regex, SyntaxTree& tree, ParseError& error, uint32_t max_symbol)
+        : regex(regex), tree(tree), error(error), max_symbol(max_symbol) {}
+
+    bool parse() {
+        TreeNode* root = parse_alternation();
+        if (!root) return false;
+
+        // parse_alternation only stops early on a ')' without a matching '('
+        if (pos < regex.length()) {
+            fail(pos, "unmatched ')'");
+            return false;
+        }
+        tree.root = root;
+        return true;
+    }
+
+private:
+    const string& regex;
+    SyntaxTree& tree;
+    ParseError& error;
+    uint32_t max_symbol;
+    size_t pos = 0;
+    size_t depth = 0;
+
+    TreeNode* fail(size_t at, const string& message) {
+        error.position = at;
+        error.message = message;
+        return nullptr;
+    }
+
+    TreeNode* parse_alternation() {
+        TreeNode* left = parse_concatenation();
+        if (!left) return nullptr;
+
+        while (pos < regex.length() && regex[pos] == '|') {
+            size_t op_pos = pos++;
+            TreeNode* right = parse_concatenation();
+            if (!right) return nullptr;
+            left = tree.make_node('|', op_pos, left, right);
+        }
+        return left;
+    }
+
+    TreeNode* parse_concatenation() {
+        TreeNode* result = nullptr;
+        while (pos < regex.length() && regex[pos] != '|' && regex[pos] != ')') {
+            size_t factor_pos = pos;
+            TreeNode* factor = parse_repetition();
+            if (!factor) return nullptr;
+            // implicit concatenation operator sits where the next factor starts
+            result = result ? tree.make_node('.', factor_pos, result, factor) : factor;
+        }
+        if (!result) {
+            // empty alternative, e.g. "a|" or "()", matches the empty string
+            result = tree.make_node(EPSILON, pos);
+        }
+        return result;
+    }
+
+    TreeNode* parse_repetition() {
+        TreeNode* node = parse_atom();
+        if (!node) return nullptr;
+
+        // Kleene star is postfix, only left child for unary operator
+        while (pos < regex.length() && regex[pos] == '*') {
+            node = tree.make_node('*', pos++, node);
+        }
+        return node;
+    }
+
+    TreeNode* parse_atom() {
+        char token = regex[pos];
+
+        if (isalnum(static_cast<unsigned char>(token))) {
+            return tree.make_node(token, pos++);
+        }
+        if (token == '[') {
+            return parse_class();
+        }
+        if (token == '\\') {
+            size_t escape_pos = pos;
+            uint32_t symbol;
+            if (!parse_escape(symbol)) return nullptr;
+            CharClass char_class;
+            char_class.ranges.emplace_back(symbol, symbol);
+            return make_class(move(char_class), escape_pos);
+        }
+        if (token == '(') {
+            if (depth == MAX_NESTING_DEPTH) {
+                return fail(pos, "parentheses nested too deeply");
+            }
+            size_t open_pos = pos++;
+            ++depth;
+            size_t group = tree.groups.size();   // numbered by '(' even when nested
+            tree.groups.push_back(nullptr);
+            TreeNode* inner = parse_alternation();
+            if (!inner) return nullptr;
+            if (pos >= regex.length() || regex[pos] != ')') {
+                return fail(open_pos, "missing ')' for '('");
+            }
+            ++pos;
+            --depth;
+            tree.groups[group] = inner;
+            return inner;
+        }
+        if (token == '*') {
+            return fail(pos, "'*' has nothing to repeat");
+        }
+        return fail(pos, string("unexpected character '") + token + "'");
+    }
+
+    // Bracket expression; ranges are sorted and merged so equal classes compare equal
+    TreeNode* parse_class() {
+        size_t open_pos = pos++;
+        CharClass char_class;
+        if (pos < regex.length() && regex[pos] == '^') {
+            char_class.negated = true;
+            ++pos;
+        }
+
+        vector<pair<uint32_t, uint32_t>> ranges;
+        while (pos < regex.length() && regex[pos] != ']') {
+            size_t low_pos = pos;
+            uint32_t low, high;
+            if (!parse_class_symbol(low)) return nullptr;
+            high = low;
+            if (pos + 1 < regex.length() && regex[pos] == '-' && regex[pos + 1] != ']') {
+                ++pos;
+                if (!parse_class_symbol(high)) return nullptr;
+                if (high < low) {
+                    return fail(low_pos, "range out of order");
+                }
+            }
+            ranges.emplace_back(low, high);
+        }
+        if (pos >= regex.length()) {
+            return fail(open_pos, "missing ']' for '['");
+        }
+        if (ranges.empty()) {
+            return fail(open_pos, "empty character class");
+        }
+        ++pos;
+
+        sort(ranges.begin(), ranges.end());
+        for (const auto& range : ranges) {
+            if (!char_class.ranges.empty() && range.first <= char_class.ranges.back().second + 1) {
+                char_class.ranges.back().second = max(char_class.ranges.back().second, range.second);
+            } else {
+                char_class.ranges.push_back(range);
+            }
+        }
+        return make_class(move(char_class), open_pos);
+    }
+
+    // Class leaf for the source text [start, pos)
+    TreeNode* make_class(CharClass&& char_class, size_t start) {
+        char_class.text = regex.substr(start, pos - start);
+        tree.classes.push_back(move(char_class));
+        TreeNode* node = tree.make_node(CHAR_CLASS, start);
+        node->char_class = &tree.classes.back();
+        return node;
+    }
+
+    bool parse_class_symbol(uint32_t& symbol) {
+        unsigned char token = static_cast<unsigned char>(regex[pos]);
+        if (token == '\\') return parse_escape(symbol);
+        if (!isalnum(token)) {
+            fail(pos, string("unexpected character '") + regex[pos] + "' in '['");
+            return false;
+        }
+        symbol = token;
+        ++pos;
+        return true;
+    }
+
+    // \xHH or \x{H...}; pos is on the backslash
+    bool parse_escape(uint32_t& symbol) {
+        size_t escape_pos = pos++;
+        if (pos >= regex.length() || regex[pos] != 'x') {
+            fail(escape_pos, "unknown escape, expected '\\x'");
+            return false;
+        }
+        ++pos;
+        bool braced = pos < regex.length() && regex[pos] == '{';
+        if (braced) ++pos;
+
+        symbol = 0;
+        size_t digits = 0;
+        while (pos < regex.length() && isxdigit(static_cast<unsigned char>(regex[pos]))
+               && digits < (braced ? MAX_HEX_DIGITS : 2)) {
+            symbol = symbol * 16 + hex_value(regex[pos++]);
+            ++digits;
+        }
+        if (braced ? digits == 0 || pos >= regex.length() || regex[pos] != '}' : digits != 2) {
+            fail(escape_pos, braced ? "malformed '\\x{...}' escape" : "'\\x' needs two hex digits");
+            return false;
+        }
+        if (braced) ++pos;
+        if (symbol > max_symbol) {
+            fail(escape_pos, "escape is outside the alphabet (at most " + to_string(max_symbol) + ")");
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool parse_regex(const string& regex, SyntaxTree& tree, ParseError& error, uint32_t max_symbol) {
+    tree.nodes.clear();
+    tree.classes.clear();
+    tree.groups.clear();
+    tree.root = nullptr;
+    return Parser(regex, tree, error, max_symbol).parse();
+}
+
+
+void expand_char_class(const CharClass& char_class, vector<char>& symbols) {
+    bool in_class[256] = {};
+    for (const auto& [low, high] : char_class.ranges) {
+        for (uint32_t symbol = low; symbol <= high && symbol < 256; ++symbol) {
+            in_class[symbol] = true;
+        }
+    }
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (in_class[symbol] != char_class.negated) {
+            symbols.push_back(static_cast<char>(symbol));
+        }
+    }
+}
+
+
+// The left spine is walked iteratively because the parser builds left-deep chains
+void flatten_chain(const TreeNode* node, char op, vector<const TreeNode*>& operands) {
+    vector<const TreeNode*> right_operands;
+    while (node->value == op) {
+        right_operands.push_back(node->right);
+        node = node->left;
+    }
+    operands.push_back(node);
+    for (auto it = right_operands.rbegin(); it != right_operands.rend(); ++it) {
+        if ((*it)->value == op) {
+            flatten_chain(*it, op, operands);   // parenthesized chain, e.g. a|(b|c)
+        } else {
+            operands.push_back(*it);
+        }
+    }
+}
+
+
+/*
+Display helpers
+The visualizer still shows the explicit-concatenation and postfix forms,
+so they are rebuilt from the tree instead of being parser stages.
+*/
+namespace {
+
+int node_precedence(const TreeNode* node) {
+    switch (node->value) {
+        case '|': return 1;
+        case '.': return 2;
+        case '*': return 3;
+        default: return 4; // symbol or ε
+    }
+}
+
+void append_symbol(string& out, const TreeNode* node) {
+    if (node->value == EPSILON) {
+        out += "ε";
+    } else if (node->value == CHAR_CLASS && node->char_class) {
+        out += node->char_class->text;
+    } else {
+        out += node->value;
+    }
+}
+
+void write_infix(const TreeNode* node, string& out) {
+    if (node->value == '*') {
+        bool parens = node_precedence(node->left) < 3;
+        if (parens) out += '(';
+        write_infix(node->left, out);
+        if (parens) out += ')';
+        out += '*';
+    } else if (node->value == '.' || node->value == '|') {
+        int prec = node_precedence(node);
+        bool left_parens = node_precedence(node->left) < prec;
+        bool right_parens = node_precedence(node->right) <= prec;
+        if (left_parens) out += '(';
+        write_infix(node->left, out);
+        if (left_parens) out += ')';
+        out += node->value;
+        if (right_parens) out += '(';
+        write_infix(node->right, out);
+        if (right_parens) out += ')';
+    } else {
+        append_symbol(out, node);
+    }
+}
+
+void write_postfix(const TreeNode* node, string& out) {
+    if (node->left) write_postfix(node->left, out);
+    if (node->right) write_postfix(node->right, out);
+    if (node->value == '*' || node->value == '.' || node->value == '|') {
+        out += node->value;
+    } else {
+        append_symbol(out, node);
+    }
+}
+
+} // namespace
+
+string tree_to_infix(const TreeNode* node) {
+    string out;
+    if (node) write_infix(node, out);
+    return out;
+}
+
+string tree_to_postfix(const TreeNode* node) {
+    string out;
+    if (node) write_postfix(node, out);
+    return out;
+}
@@ -0,0 +1,85 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// Symbols of a bracket expression such as [a-z0-9] or [^abc], or of an
+// escape such as \x00 (a one-symbol class)
+struct CharClass {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;  // inclusive, sorted, disjoint
+    bool negated = false;
+    std::string text;   // as written, for display
+};
+
+// Leaf value of a bracket expression; the node's char_class holds the symbols
+constexpr char CHAR_CLASS = '[';
+
+// Tree node for syntax tree
+// Nodes are owned by the SyntaxTree arena, children are plain pointers into it.
+struct TreeNode {
+    char value;
+    TreeNode* left;
+    TreeNode* right;
+    size_t position;   // offset of the token in the source regex
+    const CharClass* char_class = nullptr;  // only for CHAR_CLASS leaves
+    float x = 0;   // for drawing
+    float y = 0;   // for drawing
+
+    TreeNode(char val, size_t pos) : value(val), left(nullptr), right(nullptr), position(pos) {}
+};
+
+// Syntax tree with all nodes stored in one arena.
+// std::deque never relocates elements on push_back (or when the tree is moved),
+// so the child pointers stay valid for the lifetime of the tree.
+struct SyntaxTree {
+    std::deque<TreeNode> nodes;
+    std::deque<CharClass> classes;   // referenced by CHAR_CLASS leaves
+    // Capture groups in order of their '(': groups[k - 1] is the subtree of
+    // group k. Groups add no nodes, so only capture-aware code sees them.
+    std::vector<const TreeNode*> groups;
+    TreeNode* root = nullptr;
+
+    SyntaxTree() = default;
+    SyntaxTree(const SyntaxTree&) = delete;
+    SyntaxTree& operator=(const SyntaxTree&) = delete;
+    SyntaxTree(SyntaxTree&&) = default;
+    SyntaxTree& operator=(SyntaxTree&&) = default;
+
+    TreeNode* make_node(char value, size_t position,
+                        TreeNode* left = nullptr, TreeNode* right = nullptr);
+};
+
+// Parse error with the offset in the regex where it was detected
+struct ParseError {
+    size_t position = 0;
+    std::string message;
+};
+
+// Step 1 - Receive regex input
+std::string receive_regex_input();
+
+// Step 2 - Parse the regex into a syntax tree in a single pass
+// Returns false and fills `error` if the regex is malformed. Escapes above
+// max_symbol are errors; the default is the byte alphabet of the char pipeline.
+bool parse_regex(const std::string& regex, SyntaxTree& tree, ParseError& error,
+                 uint32_t max_symbol = 0xFF);
+
+// Symbols of a class for the char pipeline: bytes 0-255,
+// negated classes are complemented within that range
+void expand_char_class(const CharClass& char_class, std::vector<char>& symbols);
+
+// Operands of a chain of one binary operator ('|' or '.'), left to right,
+// e.g. ((a|b)|(c|d)) -> a, b, c, d
+void flatten_chain(const TreeNode* node, char op, std::vector<const TreeNode*>& operands);
+
+// Helpers for display: the regex with explicit '.' operators and its postfix form,
+// both rebuilt from the syntax tree
+std::string tree_to_infix(const TreeNode* node);
+std::string tree_to_postfix(const TreeNode* node);
+
+#endif
@@ -0,0 +1,223 @@
+#include "rule_loader.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RULE_LOADER_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+// This file loads rule packs (one regex per line) into syntax trees.
+// The text is cut into chunks on line boundaries and every chunk is parsed
+// by its own thread; line numbers are fixed up once all chunks are done.
+
+namespace {
+
+// Chunks smaller than this are not worth a thread
+constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+// Result of parsing one chunk; line numbers are relative to the chunk
+struct ChunkResult {
+    vector<Rule> rules;
+    vector<bool> has_explicit_id;
+    vector<RuleError> errors;
+    size_t line_count = 0;
+};
+
+bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void add_error(ChunkResult& result, size_t line, size_t position, const string& message) {
+    RuleError error;
+    error.line = line;
+    error.position = position;
+    error.message = message;
+    result.errors.push_back(move(error));
+}
+
+// Parse a single line "<regex>", "<id>:<regex>" or "<id>:/<regex>/<flags>"
+void parse_rule_line(const char* begin, const char* end, size_t line, ChunkResult& result) {
+    const char* line_start = begin;
+    while (begin < end && is_blank(*begin)) ++begin;
+    while (end > begin && is_blank(end[-1])) --end;
+    if (begin == end || *begin == '#') return;
+
+    Rule rule;
+    rule.line = line;
+    bool explicit_id = false;
+
+    // optional numeric id followed by ':'
+    const char* p = begin;
+    unsigned long long id = 0;
+    bool id_overflow = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        id = id * 10 + static_cast<unsigned>(*p - '0');
+        if (id > 0xFFFFFFFFull) {
+            id_overflow = true;
+            id = 0xFFFFFFFFull;
+        }
+        ++p;
+    }
+    if (p > begin && p < end && *p == ':') {
+        if (id_overflow) {
+            add_error(result, line, begin - line_start, "rule id out of range");
+            return;
+        }
+        rule.id = static_cast<unsigned>(id);
+        explicit_id = true;
+        begin = p + 1;
+    }
+
+    // optional /regex/flags form
+    const char* regex_begin = begin;
+    const char* regex_end = end;
+    if (begin < end && *begin == '/') {
+        const char* closing = end;
+        while (closing > begin + 1 && closing[-1] != '/') --closing;
+        if (closing == begin + 1) {
+            add_error(result, line, begin - line_start, "missing closing '/'");
+            return;
+        }
+        regex_begin = begin + 1;
+        regex_end = closing - 1;
+        for (const char* f = closing; f < end; ++f) {
+            switch (*f) {
+                case 'e': rule.flags |= RULE_FLAG_EARLIEST; break;
+                case 's': rule.flags |= RULE_FLAG_SINGLE; break;
+                default:
+                    add_error(result, line, f - line_start, string("unknown flag '") + *f + "'");
+                    return;
+            }
+        }
+    }
+
+    rule.pattern.assign(regex_begin, regex_end);
+    ParseError parse_error;
+    if (!parse_regex(rule.pattern, rule.tree, parse_error)) {
+        add_error(result, line, (regex_begin - line_start) + parse_error.position, parse_error.message);
+        return;
+    }
+    result.rules.push_back(move(rule));
+    result.has_explicit_id.push_back(explicit_id);
+}
+
+void parse_chunk(const char* begin, const char* end, ChunkResult& result) {
+    // Reserve up front: moving a Rule is not free (its arena is a std::deque)
+    size_t line_estimate = count(begin, end, '\n') + 1;
+    result.rules.reserve(line_estimate);
+    result.has_explicit_id.reserve(line_estimate);
+
+    const char* line_begin = begin;
+    while (line_begin < end) {
+        const char* newline = static_cast<const char*>(memchr(line_begin, '\n', end - line_begin));
+        const char* line_end = newline ? newline : end;
+        parse_rule_line(line_begin, line_end, ++result.line_count, result);
+        line_begin = line_end + 1;
+    }
+}
+
+} // namespace
+
+void parse_rules(const char* data, size_t size, RuleSet& rule_set, unsigned num_threads) {
+    if (num_threads == 0) {
+        num_threads = max(1u, thread::hardware_concurrency());
+    }
+    size_t num_chunks = min<size_t>(num_threads, max<size_t>(1, size / MIN_CHUNK_SIZE));
+
+    // Cut the text into chunks that start right after a '\n'
+    vector<const char*> bounds;
+    bounds.push_back(data);
+    for (size_t i = 1; i < num_chunks; ++i) {
+        const char* cut = data + size * i / num_chunks;
+        if (cut < bounds.back()) cut = bounds.back();
+        const char* newline = static_cast<const char*>(memchr(cut, '\n', data + size - cut));
+        bounds.push_back(newline ? newline + 1 : data + size);
+    }
+    bounds.push_back(data + size);
+
+    vector<ChunkResult> results(num_chunks);
+    vector<thread> workers;
+    for (size_t i = 1; i < num_chunks; ++i) {
+        workers.emplace_back(parse_chunk, bounds[i], bounds[i + 1], ref(results[i]));
+    }
+    parse_chunk(bounds[0], bounds[1], results[0]); // this thread takes the first chunk
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Merge in file order, turning chunk-relative line numbers into file line numbers
+    size_t total_rules = rule_set.rules.size();
+    for (const auto& result : results) {
+        total_rules += result.rules.size();
+    }
+    rule_set.rules.reserve(total_rules);
+
+    size_t line_offset = 0;
+    for (auto& result : results) {
+        for (size_t i = 0; i < result.rules.size(); ++i) {
+            Rule& rule = result.rules[i];
+            rule.line += line_offset;
+            if (!result.has_explicit_id[i]) {
+                rule.id = static_cast<unsigned>(rule.line);
+            }
+            rule_set.rules.push_back(move(rule));
+        }
+        for (auto& error : result.errors) {
+            error.line += line_offset;
+            rule_set.errors.push_back(move(error));
+        }
+        line_offset += result.line_count;
+    }
+}
+
+bool load_rule_file(const string& filename, RuleSet& rule_set, unsigned num_threads) {
+    RuleError open_error;
+    open_error.message = "failed to read rule file: " + filename;
+
+#ifdef RULE_LOADER_HAS_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        rule_set.errors.push_back(open_error);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        rule_set.errors.push_back(open_error);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        rule_set.errors.push_back(open_error);
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    parse_rules(static_cast<const char*>(mapped), size, rule_set, num_threads);
+    munmap(mapped, size);
+#else
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        rule_set.errors.push_back(open_error);
+        return false;
+    }
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    parse_rules(text.data(), text.size(), rule_set, num_threads);
+#endif
+    return true;
+}
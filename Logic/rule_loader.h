@@ -0,0 +1,55 @@
+#ifndef RULE_LOADER_H
+#define RULE_LOADER_H
+
+#include "parser.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+Rule file format, one rule per line:
+
+    # comment
+    <regex>
+    <id>:<regex>
+    <id>:/<regex>/<flags>
+
+Blank lines and '#' comments are skipped. Rules without an id get their
+line number as id. Flags are single letters, see RuleFlags.
+*/
+
+enum RuleFlags : unsigned {
+    RULE_FLAG_NONE = 0,
+    RULE_FLAG_EARLIEST = 1u << 0,   // 'e': report a match as soon as it ends
+    RULE_FLAG_SINGLE = 1u << 1,     // 's': report only the first match
+};
+
+struct Rule {
+    unsigned id = 0;
+    unsigned flags = RULE_FLAG_NONE;
+    size_t line = 0;          // 1-based line number in the rule file
+    std::string pattern;
+    SyntaxTree tree;
+};
+
+// Error for one rule; line 0 means the file itself could not be read
+struct RuleError {
+    size_t line = 0;
+    size_t position = 0;      // offset in the line
+    std::string message;
+};
+
+struct RuleSet {
+    std::vector<Rule> rules;          // in file order
+    std::vector<RuleError> errors;    // in file order
+};
+
+// Parse rules from memory, splitting the text on line boundaries across threads
+// (num_threads = 0 uses the hardware concurrency)
+void parse_rules(const char* data, size_t size, RuleSet& rule_set, unsigned num_threads = 0);
+
+// Map a rule file into memory and parse it with parse_rules
+// Returns false if the file could not be read.
+bool load_rule_file(const std::string& filename, RuleSet& rule_set, unsigned num_threads = 0);
+
+#endif
@@ -0,0 +1,216 @@
+#include "rule_set_compiler.h"
+#include "compiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <string>
+using namespace std;
+
+/*
+Grouping
+Step 1 - compile every rule to a minimized search DFA labeled with its id
+Step 2 - estimate how badly each pattern interacts with the others: the
+         extra states of the pairwise union DFA over the two separate DFAs
+         (only for rule sets up to PAIRWISE_LIMIT rules, the estimate needs
+         n^2 / 2 product constructions)
+Step 3 - place the patterns greedily, worst interacting first, so they are
+         spread over different groups before the groups fill up. A pattern
+         joins the group whose union grows least and stays within the
+         budget; a pattern that fits nowhere opens a new group (or, with k
+         groups already open, goes to the smallest group, over budget).
+         Every merged group is minimized at once, so the next union and
+         growth check start from the real group size.
+Step 4 - measure how fast each group DFA scans
+
+The budget is checked against the unminimized product of the minimized
+group and the new pattern, which is never smaller than the merged DFA, so
+every group within budget stays within it.
+*/
+
+namespace {
+
+constexpr size_t PAIRWISE_LIMIT = 512;
+// Hard limit for a single rule or an over-budget group
+constexpr size_t MAX_TABLE_STATES = 1 << 18;
+
+struct Candidate {
+    unsigned id;
+    size_t line;
+    DFATable table;
+    size_t interaction = 0;
+};
+
+struct PendingGroup {
+    vector<unsigned> rule_ids;
+    DFATable table;
+    bool over_budget = false;
+};
+
+// Pseudo-random text over the bytes the rules use
+string calibration_input(const RuleSet& rule_set, size_t size) {
+    string alphabet;
+    bool used[256] = {};
+    for (const Rule& rule : rule_set.rules) {
+        for (unsigned char ch : rule.pattern) {
+            if (isalnum(ch) && !used[ch]) {
+                used[ch] = true;
+                alphabet += static_cast<char>(ch);
+            }
+        }
+    }
+    if (alphabet.empty()) alphabet = "a";
+
+    string input(size, '\0');
+    uint64_t x = 0x2545f4914f6cdd1dULL;
+    for (char& ch : input) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        ch = alphabet[x % alphabet.size()];
+    }
+    return input;
+}
+
+double measure_throughput(const DFATable& table, const string& input) {
+    auto begin = chrono::steady_clock::now();
+    uint32_t state = table.start;
+    size_t matches = 0;
+    for (char ch : input) {
+        state = table.next(state, static_cast<unsigned char>(ch));
+        matches += table.accepting[state];
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    // keeps the loop from being optimized away
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(matches));
+#else
+    static volatile size_t sink;
+    sink = matches;
+#endif
+    return elapsed.count() > 0 ? input.size() / elapsed.count() : 0;
+}
+
+} // namespace
+
+size_t RuleGrouping::total_states() const {
+    size_t states = 0;
+    for (const auto& group : groups) states += group.table.num_states;
+    return states;
+}
+
+size_t RuleGrouping::memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto& group : groups) bytes += group.table.memory_bytes();
+    return bytes;
+}
+
+double RuleGrouping::bytes_per_second() const {
+    double seconds_per_byte = 0;
+    for (const auto& group : groups) {
+        if (group.bytes_per_second <= 0) return 0;
+        seconds_per_byte += 1 / group.bytes_per_second;
+    }
+    return seconds_per_byte > 0 ? 1 / seconds_per_byte : 0;
+}
+
+size_t interaction_cost(const DFATable& a, const DFATable& b, size_t cap) {
+    size_t separate = a.num_states + b.num_states - 1;  // one shared dead state
+    size_t together = union_dfa_tables(a, b, separate + cap, nullptr);
+    if (together == 0) return cap;
+    return together > separate ? together - separate : 0;
+}
+
+RuleGrouping group_rules(const RuleSet& rule_set, const RuleGroupingOptions& options) {
+    RuleGrouping grouping;
+    const size_t budget = options.max_group_states;
+
+    // Step 1: one search DFA per rule
+    vector<Candidate> candidates;
+    candidates.reserve(rule_set.rules.size());
+    for (const Rule& rule : rule_set.rules) {
+        DFATable anchored = build_dfa_table(compile_min_dfa(rule.tree.root), rule.id);
+        DFATable search;
+        if (!build_search_table(anchored, search, MAX_TABLE_STATES)) {
+            grouping.errors.push_back({rule.line, 0,
+                "search DFA exceeds " + to_string(MAX_TABLE_STATES) + " states"});
+            continue;
+        }
+        candidates.push_back({rule.id, rule.line, minimize_dfa_table(search)});
+    }
+
+    // Step 2: pairwise interaction
+    if (candidates.size() <= PAIRWISE_LIMIT) {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            for (size_t j = i + 1; j < candidates.size(); ++j) {
+                size_t cost = interaction_cost(candidates[i].table, candidates[j].table, budget);
+                candidates[i].interaction += cost;
+                candidates[j].interaction += cost;
+            }
+        }
+    }
+    stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.interaction != b.interaction) return a.interaction > b.interaction;
+        return a.table.num_states > b.table.num_states;
+    });
+
+    // Step 3: greedy placement
+    vector<PendingGroup> pending;
+    for (Candidate& candidate : candidates) {
+        const DFATable& table = candidate.table;
+        size_t best = pending.size();
+        size_t best_growth = SIZE_MAX;
+        for (size_t g = 0; g < pending.size() && best_growth > 0; ++g) {
+            size_t together = union_dfa_tables(pending[g].table, table, budget, nullptr);
+            if (together == 0) continue;
+            size_t separate = pending[g].table.num_states + table.num_states - 1;
+            size_t growth = together > separate ? together - separate : 0;
+            if (growth < best_growth) {
+                best = g;
+                best_growth = growth;
+            }
+        }
+
+        bool may_open = options.max_groups == 0 || pending.size() < options.max_groups;
+        if (best == pending.size() && may_open) {
+            PendingGroup group;
+            group.rule_ids.push_back(candidate.id);
+            group.over_budget = table.num_states > budget;
+            group.table = move(candidate.table);
+            pending.push_back(move(group));
+            continue;
+        }
+        if (best == pending.size()) {
+            best = 0;
+            for (size_t g = 1; g < pending.size(); ++g) {
+                if (pending[g].table.num_states < pending[best].table.num_states) best = g;
+            }
+            pending[best].over_budget = true;
+        }
+
+        DFATable merged;
+        if (union_dfa_tables(pending[best].table, table, MAX_TABLE_STATES, &merged) == 0) {
+            grouping.errors.push_back({candidate.line, 0,
+                "union with its group exceeds " + to_string(MAX_TABLE_STATES) + " states"});
+            continue;
+        }
+        // Minimized now, so later unions and growth checks see the real group size
+        pending[best].table = minimize_dfa_table(merged);
+        pending[best].rule_ids.push_back(candidate.id);
+    }
+
+    // Step 4: measure
+    string input = calibration_input(rule_set, options.calibration_bytes);
+    for (PendingGroup& group : pending) {
+        RuleGroup result;
+        result.rule_ids = move(group.rule_ids);
+        sort(result.rule_ids.begin(), result.rule_ids.end());
+        result.table = move(group.table);
+        result.over_budget = group.over_budget;
+        if (!input.empty()) result.bytes_per_second = measure_throughput(result.table, input);
+        grouping.groups.push_back(move(result));
+    }
+    stable_sort(grouping.errors.begin(), grouping.errors.end(),
+                [](const RuleError& a, const RuleError& b) { return a.line < b.line; });
+    return grouping;
+}
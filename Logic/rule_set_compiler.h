@@ -0,0 +1,48 @@
+#ifndef RULE_SET_COMPILER_H
+#define RULE_SET_COMPILER_H
+
+#include "rule_loader.h"
+#include "dfa_table.h"
+#include <vector>
+#include <cstddef>
+
+/*
+Rule-set compilation with pattern grouping (Yu, Chen, Diao, Lakshman & Katz, 2006)
+
+One DFA for all rules can blow up exponentially when patterns interact
+(their search DFAs have to track progress in several patterns at once),
+while one DFA per rule means one pass over the input per rule. The rules
+are therefore split into groups whose union DFA stays below a state budget;
+each group is scanned in one pass.
+*/
+
+struct RuleGroupingOptions {
+    size_t max_group_states = 10000;  // budget for the union search DFA of one group
+    size_t max_groups = 0;            // k; 0 opens as many groups as the budget needs
+    size_t calibration_bytes = 1 << 18;  // input scanned to measure throughput; 0 skips it
+};
+
+struct RuleGroup {
+    std::vector<unsigned> rule_ids;
+    DFATable table;               // minimized search DFA, match_ids hold rule ids
+    bool over_budget = false;     // max_groups reached, or one rule alone exceeds the budget
+    double bytes_per_second = 0;  // measured scan speed of table
+};
+
+struct RuleGrouping {
+    std::vector<RuleGroup> groups;
+    std::vector<RuleError> errors;  // rules whose search DFA could not be built
+
+    size_t total_states() const;
+    size_t memory_bytes() const;
+    // Estimated speed of matching all rules: one pass over the input per group
+    double bytes_per_second() const;
+};
+
+// Extra states a union of two search DFAs needs beyond the states of both
+// (0 if the patterns do not interact); stops counting at the cap
+size_t interaction_cost(const DFATable& a, const DFATable& b, size_t cap);
+
+RuleGrouping group_rules(const RuleSet& rule_set, const RuleGroupingOptions& options = {});
+
+#endif
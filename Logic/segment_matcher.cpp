@@ -0,0 +1,88 @@
+#include "segment_matcher.h"
+
+using namespace std;
+
+namespace {
+
+#ifdef SEGMENT_MATCHER_HAS_IOVEC
+string_view as_view(const iovec& segment) {
+    return string_view(static_cast<const char*>(segment.iov_base), segment.iov_len);
+}
+#endif
+
+string_view as_view(string_view segment) {
+    return segment;
+}
+
+template <typename Segment>
+bool match_segments(const DFATable& table, const Segment* segments, size_t count) {
+    SegmentScanner scanner(table);
+    for (size_t i = 0; i < count && !scanner.dead(); ++i) {
+        scanner.feed(as_view(segments[i]));
+    }
+    return scanner.accepting();
+}
+
+template <typename Segment>
+void scan_all(const DFATable& table, const Segment* segments, size_t count, vector<SegmentMatch>& matches) {
+    SegmentScanner scanner(table);
+    if (count == 0) scanner.feed(string_view(), &matches);   // still report offset 0
+    for (size_t i = 0; i < count; ++i) {
+        scanner.feed(as_view(segments[i]), &matches);
+    }
+}
+
+} // namespace
+
+void SegmentScanner::report(vector<SegmentMatch>& matches) const {
+    const vector<uint32_t>* ids = state < table->match_ids.size() ? &table->match_ids[state] : nullptr;
+    if (!ids || ids->empty()) {
+        matches.push_back({UINT32_MAX, position});
+        return;
+    }
+    for (uint32_t id : *ids) matches.push_back({id, position});
+}
+
+void SegmentScanner::feed(string_view segment, vector<SegmentMatch>* matches) {
+    if (!matches) {
+        // Match-only: a plain table walk, stopping in the dead state
+        uint32_t s = state;
+        for (size_t i = 0; i < segment.size() && s != DFATable::DEAD_STATE; ++i) {
+            s = table->next(s, static_cast<unsigned char>(segment[i]));
+        }
+        state = s;
+        position += segment.size();
+        started = true;
+        return;
+    }
+
+    if (!started && table->accepting[state]) report(*matches);
+    started = true;
+    const size_t base = position;
+    for (size_t i = 0; i < segment.size() && state != DFATable::DEAD_STATE; ++i) {
+        state = table->next(state, static_cast<unsigned char>(segment[i]));
+        if (table->accepting[state]) {
+            position = base + i + 1;
+            report(*matches);
+        }
+    }
+    position = base + segment.size();
+}
+
+bool dfa_table_match(const DFATable& table, const string_view* segments, size_t count) {
+    return match_segments(table, segments, count);
+}
+
+void scan_segments(const DFATable& table, const string_view* segments, size_t count, vector<SegmentMatch>& matches) {
+    scan_all(table, segments, count, matches);
+}
+
+#ifdef SEGMENT_MATCHER_HAS_IOVEC
+bool dfa_table_match(const DFATable& table, const iovec* segments, size_t count) {
+    return match_segments(table, segments, count);
+}
+
+void scan_segments(const DFATable& table, const iovec* segments, size_t count, vector<SegmentMatch>& matches) {
+    scan_all(table, segments, count, matches);
+}
+#endif
@@ -0,0 +1,69 @@
+#ifndef SEGMENT_MATCHER_H
+#define SEGMENT_MATCHER_H
+
+#include "dfa_table.h"
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#define SEGMENT_MATCHER_HAS_IOVEC 1
+#endif
+
+/*
+Matching scattered input (segment chains, iovec arrays) in place
+
+The input is a sequence of segments, e.g. protocol headers followed by body
+fragments, matched as if they were concatenated without assembling them:
+the DFA state carries over from one segment to the next, and offsets are
+logical (counted from the first byte of the first segment).
+
+Works on any DFATable: anchored tables for whole-input matches, search
+tables (build_search_table, rule groups) for match ends anywhere.
+*/
+
+struct SegmentMatch {
+    uint32_t match_id;   // rule id from the table's match_ids, UINT32_MAX if unlabeled
+    size_t end;          // logical offset just after the match
+};
+
+class SegmentScanner {
+public:
+    explicit SegmentScanner(const DFATable& table) : table(&table), state(table.start) {}
+
+    // Continues with the next segment. With `matches`, appends every
+    // accepting position (offset 0 included, reported by the first call).
+    void feed(std::string_view segment, std::vector<SegmentMatch>* matches = nullptr);
+
+    // After the segments fed so far: an anchored table accepts the whole input
+    bool accepting() const { return table->accepting[state] != 0; }
+    // No continuation can be accepted (anchored tables only)
+    bool dead() const { return state == DFATable::DEAD_STATE; }
+    size_t offset() const { return position; }
+
+    void reset() { *this = SegmentScanner(*table); }
+
+private:
+    const DFATable* table;
+    uint32_t state;
+    size_t position = 0;
+    bool started = false;
+
+    void report(std::vector<SegmentMatch>& matches) const;
+};
+
+// Whole-input match of an anchored table against the concatenated segments
+bool dfa_table_match(const DFATable& table, const std::string_view* segments, size_t count);
+// Every accepting position of the concatenated segments, in input order
+void scan_segments(const DFATable& table, const std::string_view* segments, size_t count,
+                   std::vector<SegmentMatch>& matches);
+
+#ifdef SEGMENT_MATCHER_HAS_IOVEC
+bool dfa_table_match(const DFATable& table, const iovec* segments, size_t count);
+void scan_segments(const DFATable& table, const iovec* segments, size_t count,
+                   std::vector<SegmentMatch>& matches);
+#endif
+
+#endif
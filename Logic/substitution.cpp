@@ -0,0 +1,96 @@
+#include "substitution.h"
+
+#include <algorithm>
+#include <cctype>
+using namespace std;
+
+bool Substituter::build(const SyntaxTree& tree, string_view replacement, ParseError& error) {
+    *this = Substituter();
+    if (!parse_template(replacement, tree.groups.size(), error)) return false;
+
+    if (!finder.build(tree.root)) {
+        error = {0, "search automaton too large"};
+        return false;
+    }
+    if (needs_captures && !captures.build(tree)) {
+        error = {0, "capture automaton too large"};
+        return false;
+    }
+    return true;
+}
+
+bool Substituter::parse_template(string_view replacement, size_t num_groups, ParseError& error) {
+    auto add_literal = [&](string_view literal) {
+        if (literal.empty()) return;
+        if (!pieces.empty() && pieces.back().group == NO_GROUP) {
+            pieces.back().length += literal.size();
+        } else {
+            pieces.push_back({NO_GROUP, text.size(), literal.size()});
+        }
+        text.append(literal);
+    };
+
+    size_t pos = 0;
+    while (pos < replacement.size()) {
+        size_t dollar = replacement.find('$', pos);
+        if (dollar == string_view::npos) {
+            add_literal(replacement.substr(pos));
+            break;
+        }
+        add_literal(replacement.substr(pos, dollar - pos));
+        pos = dollar + 1;
+        if (pos < replacement.size() && replacement[pos] == '$') {
+            add_literal("$");
+            ++pos;
+            continue;
+        }
+
+        bool braced = pos < replacement.size() && replacement[pos] == '{';
+        if (braced) ++pos;
+        size_t group = 0, digits = 0;
+        while (pos < replacement.size() && isdigit(static_cast<unsigned char>(replacement[pos]))
+               && (braced || digits == 0)) {
+            // Saturate past the last group so long numbers cannot overflow
+            group = min(group * 10 + static_cast<size_t>(replacement[pos++] - '0'), num_groups + 1);
+            ++digits;
+        }
+        if (digits == 0 || (braced && (pos >= replacement.size() || replacement[pos] != '}'))) {
+            error = {dollar, braced ? "malformed '${n}' reference" : "'$' must be followed by a digit, '{' or '$'"};
+            return false;
+        }
+        if (braced) ++pos;
+        if (group > num_groups) {
+            error = {dollar, "group " + to_string(group) + " does not exist"};
+            return false;
+        }
+        pieces.push_back({group, 0, 0});
+        needs_captures = needs_captures || group != 0;
+    }
+    return true;
+}
+
+size_t Substituter::replace_all(string_view input, OutputSink& out) const {
+    size_t replaced = 0;
+    size_t copied = 0;   // input before this offset is already written
+    vector<Capture> groups;
+    for (const MatchSpan& match : finder.find_all(input)) {
+        out.write(input.data() + copied, match.begin - copied);
+        copied = match.end;
+        ++replaced;
+
+        string_view matched = input.substr(match.begin, match.end - match.begin);
+        if (needs_captures) captures.match(matched, groups);
+        for (const Piece& piece : pieces) {
+            if (piece.group == NO_GROUP) {
+                out.write(text.data() + piece.begin, piece.length);
+            } else if (piece.group == 0) {
+                out.write(matched.data(), matched.size());
+            } else if (groups[piece.group].matched()) {
+                const Capture& capture = groups[piece.group];
+                out.write(matched.data() + capture.begin, capture.end - capture.begin);
+            }
+        }
+    }
+    out.write(input.data() + copied, input.size() - copied);
+    return replaced;
+}
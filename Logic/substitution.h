@@ -0,0 +1,86 @@
+#ifndef SUBSTITUTION_H
+#define SUBSTITUTION_H
+
+#include "match_iterator.h"
+#include "tagged_dfa.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/*
+Regex substitution without per-match strings
+
+Matches come from MatchFinder (leftmost-longest, non-overlapping). The
+output is written piecewise to a sink: the input between matches and the
+replacement, whose capture references are sliced straight out of the
+input. Captures are only computed (with a TaggedDFA, on the matched span)
+when the template references a group other than $0.
+
+Replacement template:
+    $0 .. $9    group n (group 0 is the whole match)
+    ${n}        group n, any number of digits
+    $$          a literal '$'
+A group that did not take part in the match is replaced by nothing.
+*/
+
+// Destination of the substituted output
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char* data, size_t size) = 0;
+};
+
+// Appends to a caller-owned string, which grows as needed
+class StringSink : public OutputSink {
+public:
+    explicit StringSink(std::string& buffer) : buffer(buffer) {}
+    void write(const char* data, size_t size) override { buffer.append(data, size); }
+
+private:
+    std::string& buffer;
+};
+
+// Streams to an ostream (file, stdout, ...)
+class StreamSink : public OutputSink {
+public:
+    explicit StreamSink(std::ostream& stream) : stream(stream) {}
+    void write(const char* data, size_t size) override { stream.write(data, static_cast<std::streamsize>(size)); }
+
+private:
+    std::ostream& stream;
+};
+
+class Substituter {
+public:
+    // Returns false and fills `error` if the template is malformed, names a
+    // group the regex does not have, or an automaton would be too large
+    // (error.position is an offset in the template)
+    bool build(const SyntaxTree& tree, std::string_view replacement, ParseError& error);
+
+    // Replaces every match; returns the number of replacements
+    size_t replace_all(std::string_view input, OutputSink& out) const;
+    size_t replace_all(std::string_view input, std::string& out) const {
+        StringSink sink(out);
+        return replace_all(input, sink);
+    }
+
+private:
+    struct Piece {
+        size_t group;        // NO_GROUP for literal text
+        size_t begin;        // literal: range in `text`
+        size_t length;
+    };
+    static constexpr size_t NO_GROUP = SIZE_MAX;
+
+    MatchFinder finder;
+    TaggedDFA captures;
+    bool needs_captures = false;
+    std::string text;
+    std::vector<Piece> pieces;
+
+    bool parse_template(std::string_view replacement, size_t num_groups, ParseError& error);
+};
+
+#endif
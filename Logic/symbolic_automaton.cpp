@@ -0,0 +1,439 @@
+#include "symbolic_automaton.h"
+#include "dfa_table.h"
+#include "thompsons_construction.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <cctype>
+#include <cstdio>
+using namespace std;
+
+/*
+Symbolic pipeline, same stages as the char pipeline:
+syntax tree -> ε-NFA (build_symbolic_nfa) -> DFA (symbolic_nfa_to_dfa)
+-> minimized DFA (minimize_symbolic_dfa)
+
+Minterms
+Every range boundary (low and high + 1) of every predicate cuts the alphabet
+into elementary intervals. All intervals start in one block; each
+predicate then splits every block it partly covers into "covered" and "not
+covered" parts (the same refinement build_dfa_table uses for byte classes).
+The work depends on the number of ranges, not on the size of the alphabet.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = 0;
+
+struct SubsetHash {
+    size_t operator()(const vector<uint32_t>& set) const {
+        uint64_t h = set.size();
+        for (uint32_t x : set) {
+            h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+// Append a range, merging it with the previous one when they touch
+void append_range(vector<SymbolSet::Range>& ranges, uint32_t low, uint32_t high) {
+    if (!ranges.empty() && low <= ranges.back().second + 1ULL) {
+        ranges.back().second = max(ranges.back().second, high);
+    } else {
+        ranges.emplace_back(low, high);
+    }
+}
+
+string symbol_text(uint32_t symbol) {
+    if (symbol < 128 && isalnum(static_cast<int>(symbol))) return string(1, static_cast<char>(symbol));
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), symbol < 256 ? "\\x%02X" : "\\u{%X}", symbol);
+    return buffer;
+}
+
+// Thompson's construction on predicates
+class SymbolicBuilder {
+public:
+    explicit SymbolicBuilder(SymbolicNFA& nfa) : nfa(nfa) {}
+
+    pair<uint32_t, uint32_t> build(const TreeNode* node) {
+        if (node->value == '|' || node->value == '.') {
+            vector<const TreeNode*> operands;
+            flatten_chain(node, node->value, operands);
+            vector<pair<uint32_t, uint32_t>> parts;
+            for (const TreeNode* operand : operands) parts.push_back(build(operand));
+
+            if (node->value == '.') {
+                for (size_t i = 0; i + 1 < parts.size(); ++i) {
+                    nfa.add_epsilon(parts[i].second, parts[i + 1].first);
+                }
+                return {parts.front().first, parts.back().second};
+            }
+            uint32_t start = nfa.add_state(), accept = nfa.add_state();
+            for (const auto& [part_start, part_accept] : parts) {
+                nfa.add_epsilon(start, part_start);
+                nfa.add_epsilon(part_accept, accept);
+            }
+            return {start, accept};
+        }
+
+        uint32_t start = nfa.add_state(), accept = nfa.add_state();
+        if (node->value == '*') {
+            auto [inner_start, inner_accept] = build(node->left);
+            nfa.add_epsilon(start, inner_start);
+            nfa.add_epsilon(start, accept);
+            nfa.add_epsilon(inner_accept, inner_start);
+            nfa.add_epsilon(inner_accept, accept);
+        } else if (node->value == EPSILON) {
+            nfa.add_epsilon(start, accept);
+        } else if (node->value == CHAR_CLASS) {
+            nfa.add_move(start, SymbolSet::from_class(*node->char_class, nfa.max_symbol), accept);
+        } else {
+            nfa.add_move(start, SymbolSet::single(static_cast<unsigned char>(node->value)), accept);
+        }
+        return {start, accept};
+    }
+
+private:
+    SymbolicNFA& nfa;
+};
+
+// ε-closure of `set` in place, sorted
+void close_subset(const SymbolicNFA& nfa, vector<uint32_t>& set, vector<uint32_t>& marks, uint32_t& generation) {
+    ++generation;
+    size_t kept = 0;
+    for (uint32_t s : set) {
+        if (marks[s] != generation) {
+            marks[s] = generation;
+            set[kept++] = s;
+        }
+    }
+    set.resize(kept);
+    for (size_t i = 0; i < set.size(); ++i) {
+        for (uint32_t target : nfa.states[set[i]].epsilon) {
+            if (marks[target] != generation) {
+                marks[target] = generation;
+                set.push_back(target);
+            }
+        }
+    }
+    sort(set.begin(), set.end());
+}
+
+} // namespace
+
+SymbolSet SymbolSet::range(uint32_t low, uint32_t high) {
+    SymbolSet set;
+    if (low <= high) set.parts.emplace_back(low, high);
+    return set;
+}
+
+SymbolSet SymbolSet::from_class(const CharClass& char_class, uint32_t max_symbol) {
+    SymbolSet set;
+    for (const auto& [low, high] : char_class.ranges) {
+        if (low <= max_symbol) append_range(set.parts, low, min(high, max_symbol));
+    }
+    return char_class.negated ? set.complement(max_symbol) : set;
+}
+
+SymbolSet SymbolSet::unite(const SymbolSet& other) const {
+    vector<Range> all;
+    merge(parts.begin(), parts.end(), other.parts.begin(), other.parts.end(), back_inserter(all));
+    SymbolSet set;
+    for (const auto& [low, high] : all) append_range(set.parts, low, high);
+    return set;
+}
+
+SymbolSet SymbolSet::intersect(const SymbolSet& other) const {
+    SymbolSet set;
+    size_t i = 0, j = 0;
+    while (i < parts.size() && j < other.parts.size()) {
+        uint32_t low = max(parts[i].first, other.parts[j].first);
+        uint32_t high = min(parts[i].second, other.parts[j].second);
+        if (low <= high) set.parts.emplace_back(low, high);
+        if (parts[i].second < other.parts[j].second) ++i; else ++j;
+    }
+    return set;
+}
+
+SymbolSet SymbolSet::complement(uint32_t max_symbol) const {
+    SymbolSet set;
+    uint64_t next = 0;
+    for (const auto& [low, high] : parts) {
+        if (low > max_symbol) break;
+        if (low > next) set.parts.emplace_back(static_cast<uint32_t>(next), low - 1);
+        next = static_cast<uint64_t>(high) + 1;
+    }
+    if (next <= max_symbol) set.parts.emplace_back(static_cast<uint32_t>(next), max_symbol);
+    return set;
+}
+
+bool SymbolSet::contains(uint32_t symbol) const {
+    auto it = upper_bound(parts.begin(), parts.end(), Range{symbol, UINT32_MAX});
+    return it != parts.begin() && prev(it)->second >= symbol;
+}
+
+uint64_t SymbolSet::count() const {
+    uint64_t total = 0;
+    for (const auto& [low, high] : parts) total += static_cast<uint64_t>(high) - low + 1;
+    return total;
+}
+
+string SymbolSet::to_string() const {
+    string text = "[";
+    for (const auto& [low, high] : parts) {
+        text += symbol_text(low);
+        if (high != low) text += "-" + symbol_text(high);
+    }
+    return text + "]";
+}
+
+SymbolicNFA build_symbolic_nfa(const TreeNode* root, uint32_t max_symbol) {
+    SymbolicNFA nfa;
+    nfa.max_symbol = max_symbol;
+    if (!root) {
+        nfa.add_state();   // start without moves: empty language
+        nfa.add_state();
+        nfa.accept = 1;
+        return nfa;
+    }
+    SymbolicBuilder builder(nfa);
+    tie(nfa.start, nfa.accept) = builder.build(root);
+    return nfa;
+}
+
+vector<SymbolSet> compute_minterms(const vector<SymbolSet>& predicates, uint32_t max_symbol,
+                                   vector<vector<uint32_t>>& covers) {
+    // Elementary intervals [boundaries[i], boundaries[i + 1])
+    vector<uint64_t> boundaries{0, static_cast<uint64_t>(max_symbol) + 1};
+    for (const SymbolSet& predicate : predicates) {
+        for (const auto& [low, high] : predicate.ranges()) {
+            if (low > max_symbol) continue;
+            boundaries.push_back(low);
+            boundaries.push_back(min<uint64_t>(high, max_symbol) + 1);
+        }
+    }
+    sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+    const size_t num_intervals = boundaries.size() - 1;
+
+    auto interval_span = [&](const SymbolSet::Range& range) {
+        size_t first = lower_bound(boundaries.begin(), boundaries.end(), range.first) - boundaries.begin();
+        size_t last = lower_bound(boundaries.begin(), boundaries.end(),
+                                  min<uint64_t>(range.second, max_symbol) + 1) - boundaries.begin();
+        return make_pair(first, last);
+    };
+
+    // Refine blocks predicate by predicate
+    vector<uint32_t> block(num_intervals, 0);
+    uint32_t next_block = 1;
+    unordered_map<uint32_t, uint32_t> split;
+    for (const SymbolSet& predicate : predicates) {
+        split.clear();
+        for (const auto& range : predicate.ranges()) {
+            if (range.first > max_symbol) continue;
+            auto [first, last] = interval_span(range);
+            for (size_t i = first; i < last; ++i) {
+                auto [it, inserted] = split.emplace(block[i], next_block);
+                if (inserted) ++next_block;
+                block[i] = it->second;
+            }
+        }
+    }
+
+    // Compact block ids in order of first interval and collect the minterms
+    unordered_map<uint32_t, uint32_t> renumber;
+    vector<SymbolSet> minterms;
+    vector<vector<SymbolSet::Range>> minterm_ranges;
+    for (size_t i = 0; i < num_intervals; ++i) {
+        auto [it, inserted] = renumber.emplace(block[i], static_cast<uint32_t>(renumber.size()));
+        if (inserted) minterm_ranges.emplace_back();
+        block[i] = it->second;
+        append_range(minterm_ranges[block[i]], static_cast<uint32_t>(boundaries[i]),
+                     static_cast<uint32_t>(boundaries[i + 1] - 1));
+    }
+    for (auto& ranges : minterm_ranges) {
+        SymbolSet set;
+        for (const auto& [low, high] : ranges) set = set.unite(SymbolSet::range(low, high));
+        minterms.push_back(move(set));
+    }
+
+    covers.assign(predicates.size(), {});
+    for (size_t p = 0; p < predicates.size(); ++p) {
+        for (const auto& range : predicates[p].ranges()) {
+            if (range.first > max_symbol) continue;
+            auto [first, last] = interval_span(range);
+            for (size_t i = first; i < last; ++i) covers[p].push_back(block[i]);
+        }
+        sort(covers[p].begin(), covers[p].end());
+        covers[p].erase(unique(covers[p].begin(), covers[p].end()), covers[p].end());
+    }
+    return minterms;
+}
+
+uint32_t SymbolicDFA::minterm_of(uint32_t symbol) const {
+    size_t interval = upper_bound(interval_starts.begin(), interval_starts.end(), symbol) - interval_starts.begin() - 1;
+    return interval_minterms[interval];
+}
+
+uint32_t SymbolicDFA::next(uint32_t state, uint32_t symbol) const {
+    if (symbol > max_symbol) return DEAD;
+    return transitions[static_cast<size_t>(state) * minterms.size() + minterm_of(symbol)];
+}
+
+vector<pair<SymbolSet, uint32_t>> SymbolicDFA::transitions_of(uint32_t state) const {
+    map<uint32_t, SymbolSet> by_target;
+    for (size_t m = 0; m < minterms.size(); ++m) {
+        uint32_t target = transitions[static_cast<size_t>(state) * minterms.size() + m];
+        if (target != DEAD) by_target[target] = by_target[target].unite(minterms[m]);
+    }
+    vector<pair<SymbolSet, uint32_t>> result;
+    for (auto& [target, set] : by_target) result.emplace_back(move(set), target);
+    return result;
+}
+
+SymbolicDFA symbolic_nfa_to_dfa(const SymbolicNFA& nfa) {
+    SymbolicDFA dfa;
+    dfa.max_symbol = nfa.max_symbol;
+
+    // Step 1: minterms of all predicates on NFA moves
+    vector<SymbolSet> predicates;
+    vector<size_t> first_move(nfa.states.size() + 1, 0);
+    for (size_t s = 0; s < nfa.states.size(); ++s) {
+        first_move[s] = predicates.size();
+        for (const auto& move : nfa.states[s].moves) predicates.push_back(move.first);
+    }
+    first_move[nfa.states.size()] = predicates.size();
+    vector<vector<uint32_t>> covers;
+    dfa.minterms = compute_minterms(predicates, nfa.max_symbol, covers);
+    const size_t num_minterms = dfa.minterms.size();
+
+    // Interval lookup table for minterm_of
+    for (uint32_t m = 0; m < num_minterms; ++m) {
+        for (const auto& [low, high] : dfa.minterms[m].ranges()) {
+            dfa.interval_starts.push_back(low);
+            dfa.interval_minterms.push_back(m);
+        }
+    }
+    vector<size_t> order(dfa.interval_starts.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return dfa.interval_starts[a] < dfa.interval_starts[b]; });
+    vector<uint32_t> starts, owners;
+    for (size_t i : order) {
+        starts.push_back(dfa.interval_starts[i]);
+        owners.push_back(dfa.interval_minterms[i]);
+    }
+    dfa.interval_starts.swap(starts);
+    dfa.interval_minterms.swap(owners);
+
+    // Step 2: subset construction, one column per minterm
+    vector<uint32_t> marks(nfa.states.size(), 0);
+    uint32_t generation = 0;
+    unordered_map<vector<uint32_t>, uint32_t, SubsetHash> ids;
+    vector<vector<uint32_t>> subsets{{}};   // subsets[0] = dead state
+    ids.emplace(vector<uint32_t>(), DEAD);
+    auto id_of = [&](vector<uint32_t>& subset) {
+        auto [it, inserted] = ids.emplace(subset, static_cast<uint32_t>(subsets.size()));
+        if (inserted) subsets.push_back(subset);
+        return it->second;
+    };
+
+    vector<uint32_t> start_set{nfa.start};
+    close_subset(nfa, start_set, marks, generation);
+    dfa.start = id_of(start_set);
+
+    dfa.transitions.assign(num_minterms, DEAD);   // row of the dead state
+    dfa.accepting.assign(1, 0);
+    vector<vector<uint32_t>> next(num_minterms);
+    for (size_t i = 1; i < subsets.size(); ++i) {
+        dfa.accepting.push_back(binary_search(subsets[i].begin(), subsets[i].end(), nfa.accept) ? 1 : 0);
+        for (auto& targets : next) targets.clear();
+        for (uint32_t s : subsets[i]) {
+            for (size_t g = first_move[s]; g < first_move[s + 1]; ++g) {
+                uint32_t target = nfa.states[s].moves[g - first_move[s]].second;
+                for (uint32_t m : covers[g]) next[m].push_back(target);
+            }
+        }
+        for (size_t m = 0; m < num_minterms; ++m) {
+            close_subset(nfa, next[m], marks, generation);
+            dfa.transitions.push_back(id_of(next[m]));
+        }
+    }
+    dfa.num_states = static_cast<uint32_t>(subsets.size());
+    return dfa;
+}
+
+/*
+Minimization
+States: the table minimizer in dfa_table.cpp only looks at rows, so the
+minterm ids serve as its classes.
+Alphabet: afterwards, minterms whose columns are identical in every state
+are merged, which can only make the alphabet coarser.
+*/
+SymbolicDFA minimize_symbolic_dfa(const SymbolicDFA& dfa) {
+    const size_t num_minterms = dfa.minterms.size();
+    DFATable table;
+    table.start = dfa.start;
+    table.num_states = dfa.num_states;
+    table.num_classes = static_cast<uint32_t>(num_minterms);
+    table.transitions = dfa.transitions;
+    table.accepting = dfa.accepting;
+    DFATable minimal = minimize_dfa_table(table);
+
+    // Merge minterms with identical columns
+    unordered_map<vector<uint32_t>, uint32_t, SubsetHash> columns;
+    vector<uint32_t> merged_into(num_minterms);
+    vector<uint32_t> representative;
+    vector<uint32_t> column(minimal.num_states);
+    for (size_t m = 0; m < num_minterms; ++m) {
+        for (uint32_t s = 0; s < minimal.num_states; ++s) {
+            column[s] = minimal.transitions[static_cast<size_t>(s) * num_minterms + m];
+        }
+        auto [it, inserted] = columns.emplace(column, static_cast<uint32_t>(representative.size()));
+        if (inserted) representative.push_back(static_cast<uint32_t>(m));
+        merged_into[m] = it->second;
+    }
+
+    SymbolicDFA result;
+    result.max_symbol = dfa.max_symbol;
+    result.start = minimal.start;
+    result.num_states = minimal.num_states;
+    result.accepting = minimal.accepting;
+    result.minterms.resize(representative.size());
+    for (size_t m = 0; m < num_minterms; ++m) {
+        result.minterms[merged_into[m]] = result.minterms[merged_into[m]].unite(dfa.minterms[m]);
+    }
+    for (uint32_t s = 0; s < minimal.num_states; ++s) {
+        for (uint32_t m : representative) {
+            result.transitions.push_back(minimal.transitions[static_cast<size_t>(s) * num_minterms + m]);
+        }
+    }
+    for (size_t i = 0; i < dfa.interval_starts.size(); ++i) {
+        uint32_t m = merged_into[dfa.interval_minterms[i]];
+        if (result.interval_minterms.empty() || result.interval_minterms.back() != m) {
+            result.interval_starts.push_back(dfa.interval_starts[i]);
+            result.interval_minterms.push_back(m);
+        }
+    }
+    return result;
+}
+
+bool symbolic_dfa_match(const SymbolicDFA& dfa, string_view input) {
+    uint32_t state = dfa.start;
+    for (char ch : input) {
+        state = dfa.next(state, static_cast<unsigned char>(ch));
+        if (state == DEAD) return false;
+    }
+    return dfa.accepting[state] != 0;
+}
+
+bool symbolic_dfa_match(const SymbolicDFA& dfa, const vector<uint32_t>& symbols) {
+    uint32_t state = dfa.start;
+    for (uint32_t symbol : symbols) {
+        state = dfa.next(state, symbol);
+        if (state == DEAD) return false;
+    }
+    return dfa.accepting[state] != 0;
+}
@@ -0,0 +1,108 @@
+#ifndef SYMBOLIC_AUTOMATON_H
+#define SYMBOLIC_AUTOMATON_H
+
+#include "parser.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Symbolic automata: transitions are labeled with sets of symbols (predicates)
+instead of single symbols, so an alphabet of 256 bytes, 65536 tokens or all
+of Unicode costs the same as long as the predicates are few ranges.
+
+Determinization and minimization work over minterms: the coarsest
+partition of the alphabet in which every predicate is a union of blocks.
+Symbols in one minterm behave identically everywhere, so each minterm is
+handled once instead of every symbol.
+*/
+
+// Set of symbols as sorted, disjoint, inclusive ranges
+class SymbolSet {
+public:
+    using Range = std::pair<uint32_t, uint32_t>;
+
+    SymbolSet() = default;
+    static SymbolSet single(uint32_t symbol) { return range(symbol, symbol); }
+    static SymbolSet range(uint32_t low, uint32_t high);
+    // Symbols of a bracket expression; negated classes are complemented within [0, max_symbol]
+    static SymbolSet from_class(const CharClass& char_class, uint32_t max_symbol);
+
+    SymbolSet unite(const SymbolSet& other) const;
+    SymbolSet intersect(const SymbolSet& other) const;
+    SymbolSet complement(uint32_t max_symbol) const;
+
+    bool empty() const { return parts.empty(); }
+    bool contains(uint32_t symbol) const;
+    uint64_t count() const;
+    const std::vector<Range>& ranges() const { return parts; }
+    std::string to_string() const;   // e.g. [a-z0-9]
+
+    bool operator==(const SymbolSet& other) const { return parts == other.parts; }
+
+private:
+    std::vector<Range> parts;
+};
+
+// ε-NFA with predicate-labeled moves; state indices into `states`
+struct SymbolicNFA {
+    struct State {
+        std::vector<uint32_t> epsilon;
+        std::vector<std::pair<SymbolSet, uint32_t>> moves;
+    };
+    std::vector<State> states;
+    uint32_t start = 0;
+    uint32_t accept = 0;
+    uint32_t max_symbol = 255;
+
+    // For building automata over token ids directly
+    uint32_t add_state() {
+        states.emplace_back();
+        return static_cast<uint32_t>(states.size() - 1);
+    }
+    void add_move(uint32_t from, const SymbolSet& symbols, uint32_t to) { states[from].moves.emplace_back(symbols, to); }
+    void add_epsilon(uint32_t from, uint32_t to) { states[from].epsilon.push_back(to); }
+};
+
+// Thompson's construction over predicates; a symbol c becomes {c}, a class its
+// ranges. Unlike the char pipeline, symbol 0 is an ordinary symbol here.
+SymbolicNFA build_symbolic_nfa(const TreeNode* root, uint32_t max_symbol = 255);
+
+// Coarsest partition of [0, max_symbol] in which every predicate is a union
+// of blocks; covers[i] lists the blocks that make up predicates[i]
+std::vector<SymbolSet> compute_minterms(const std::vector<SymbolSet>& predicates, uint32_t max_symbol,
+                                        std::vector<std::vector<uint32_t>>& covers);
+
+// DFA over minterms; state 0 is dead
+struct SymbolicDFA {
+    uint32_t max_symbol = 255;
+    std::vector<SymbolSet> minterms;
+    // Symbol -> minterm: interval i = [interval_starts[i], interval_starts[i + 1])
+    std::vector<uint32_t> interval_starts;
+    std::vector<uint32_t> interval_minterms;
+
+    uint32_t start = 0;
+    uint32_t num_states = 1;
+    std::vector<uint32_t> transitions;   // state * minterms.size() + minterm
+    std::vector<uint8_t> accepting;
+
+    uint32_t minterm_of(uint32_t symbol) const;
+    uint32_t next(uint32_t state, uint32_t symbol) const;
+    // Outgoing transitions of a state to live states, minterms with the
+    // same target merged into one predicate
+    std::vector<std::pair<SymbolSet, uint32_t>> transitions_of(uint32_t state) const;
+};
+
+// Subset construction over minterms
+SymbolicDFA symbolic_nfa_to_dfa(const SymbolicNFA& nfa);
+// Merge equivalent states, then minterms that lead to the same state everywhere
+SymbolicDFA minimize_symbolic_dfa(const SymbolicDFA& dfa);
+
+// Whole-input match; bytes and wide symbols
+bool symbolic_dfa_match(const SymbolicDFA& dfa, std::string_view input);
+bool symbolic_dfa_match(const SymbolicDFA& dfa, const std::vector<uint32_t>& symbols);
+
+#endif
@@ -0,0 +1,315 @@
+#include "tagged_dfa.h"
+#include "thompsons_construction.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <map>
+using namespace std;
+
+/*
+Building the tagged DFA
+Step 1 - tagged NFA: Thompson's construction where ε-edges are ordered by
+         priority and the edges into and out of a capture group carry its
+         open and close tags
+Step 2 - byte classes: bytes that enable the same NFA transitions share a
+         column
+Step 3 - determinization over ordered lists of NFA states. The closure is
+         a depth-first walk in priority order; a state reached again later
+         has lower priority and is dropped (as in a Pike VM). Only states
+         with a byte transition and the accept state are kept in the list.
+         Each kept entry records, per tag, where its value comes from: the
+         register of the entry it was reached from, or the current position
+         if a tag edge was crossed.
+
+Registers are numbered entry * num_tags + tag, so two DFA states with the
+same ordered list are the same state and no register renaming is needed.
+*/
+
+namespace {
+
+constexpr uint32_t DEAD = 0;
+constexpr uint32_t NO_TAG = UINT32_MAX;
+constexpr uint32_t FROM_POSITION = UINT32_MAX;       // tag crossed in this closure
+constexpr uint32_t UNSET = UINT32_MAX - 1;           // tag never crossed (start only)
+
+struct TaggedNFA {
+    struct State {
+        vector<pair<uint32_t, uint32_t>> epsilon;   // (target, tag or NO_TAG), by priority
+        array<bool, 256> bytes{};
+        bool consumes = false;
+        uint32_t next = 0;
+    };
+    vector<State> states;
+    uint32_t start = 0;
+    uint32_t accept = 0;
+};
+
+class TaggedBuilder {
+public:
+    TaggedBuilder(const SyntaxTree& tree, TaggedNFA& nfa) : nfa(nfa) {
+        for (size_t g = 0; g < tree.groups.size(); ++g) {
+            groups_at[tree.groups[g]].push_back(static_cast<uint32_t>(g));
+        }
+    }
+
+    pair<uint32_t, uint32_t> build(const TreeNode* node) {
+        auto part = build_plain(node);
+        auto it = groups_at.find(node);
+        if (it == groups_at.end()) return part;
+
+        // ((a)) puts two groups on one node; the outer one (lower index) goes outside
+        for (auto g = it->second.rbegin(); g != it->second.rend(); ++g) {
+            uint32_t open = new_state(), close = new_state();
+            add_epsilon(open, part.first, 2 * *g);
+            add_epsilon(part.second, close, 2 * *g + 1);
+            part = {open, close};
+        }
+        return part;
+    }
+
+private:
+    TaggedNFA& nfa;
+    unordered_map<const TreeNode*, vector<uint32_t>> groups_at;
+
+    uint32_t new_state() {
+        nfa.states.emplace_back();
+        return static_cast<uint32_t>(nfa.states.size() - 1);
+    }
+
+    void add_epsilon(uint32_t from, uint32_t to, uint32_t tag = NO_TAG) {
+        nfa.states[from].epsilon.emplace_back(to, tag);
+    }
+
+    bool is_group(const TreeNode* node) const { return groups_at.count(node) != 0; }
+
+    // Like flatten_chain, but a group is one operand even if it is the same operator
+    void collect_operands(const TreeNode* node, char op, vector<const TreeNode*>& operands) const {
+        vector<const TreeNode*> right_operands;
+        do {
+            right_operands.push_back(node->right);
+            node = node->left;
+        } while (node->value == op && !is_group(node));
+        operands.push_back(node);
+        for (auto it = right_operands.rbegin(); it != right_operands.rend(); ++it) {
+            if ((*it)->value == op && !is_group(*it)) {
+                collect_operands(*it, op, operands);
+            } else {
+                operands.push_back(*it);
+            }
+        }
+    }
+
+    pair<uint32_t, uint32_t> build_plain(const TreeNode* node) {
+        if (node->value == '|' || node->value == '.') {
+            vector<const TreeNode*> operands;
+            collect_operands(node, node->value, operands);
+            vector<pair<uint32_t, uint32_t>> parts;
+            for (const TreeNode* operand : operands) parts.push_back(build(operand));
+
+            if (node->value == '.') {
+                for (size_t i = 0; i + 1 < parts.size(); ++i) add_epsilon(parts[i].second, parts[i + 1].first);
+                return {parts.front().first, parts.back().second};
+            }
+            uint32_t start = new_state(), accept = new_state();
+            for (const auto& [part_start, part_accept] : parts) {   // left alternatives first
+                add_epsilon(start, part_start);
+                add_epsilon(part_accept, accept);
+            }
+            return {start, accept};
+        }
+
+        uint32_t start = new_state(), accept = new_state();
+        if (node->value == '*') {
+            // Greedy: another iteration before leaving
+            auto [inner_start, inner_accept] = build(node->left);
+            add_epsilon(start, inner_start);
+            add_epsilon(start, accept);
+            add_epsilon(inner_accept, inner_start);
+            add_epsilon(inner_accept, accept);
+        } else if (node->value == EPSILON) {
+            add_epsilon(start, accept);
+        } else {
+            TaggedNFA::State& state = nfa.states[start];
+            state.consumes = true;
+            state.next = accept;
+            if (node->value == CHAR_CLASS) {
+                vector<char> symbols;
+                expand_char_class(*node->char_class, symbols);
+                for (char symbol : symbols) state.bytes[static_cast<unsigned char>(symbol)] = true;
+            } else {
+                state.bytes[static_cast<unsigned char>(node->value)] = true;
+            }
+        }
+        return {start, accept};
+    }
+};
+
+struct Entry {
+    uint32_t state;
+    vector<uint32_t> sources;   // per tag: entry index, FROM_POSITION or UNSET
+};
+
+// Priority-ordered closure of one entry; appends kept states to `out`
+void closure(const TaggedNFA& nfa, uint32_t from, const vector<uint32_t>& sources,
+             vector<uint32_t>& marks, uint32_t generation, vector<Entry>& out) {
+    vector<pair<uint32_t, vector<uint32_t>>> stack{{from, sources}};
+    while (!stack.empty()) {
+        auto [q, tags] = move(stack.back());
+        stack.pop_back();
+        if (marks[q] == generation) continue;
+        marks[q] = generation;
+
+        const TaggedNFA::State& state = nfa.states[q];
+        if (state.consumes || q == nfa.accept) out.push_back({q, tags});
+        for (auto it = state.epsilon.rbegin(); it != state.epsilon.rend(); ++it) {
+            if (marks[it->first] == generation) continue;
+            stack.emplace_back(it->first, tags);
+            if (it->second != NO_TAG) stack.back().second[it->second] = FROM_POSITION;
+        }
+    }
+}
+
+struct ListHash {
+    size_t operator()(const vector<uint32_t>& list) const {
+        uint64_t h = list.size();
+        for (uint32_t x : list) {
+            h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+} // namespace
+
+bool TaggedDFA::build(const SyntaxTree& tree, size_t max_states) {
+    *this = TaggedDFA();
+    if (!tree.root) return false;
+
+    // Step 1
+    TaggedNFA nfa;
+    TaggedBuilder builder(tree, nfa);
+    tie(nfa.start, nfa.accept) = builder.build(tree.root);
+    num_tags = static_cast<uint32_t>(2 * tree.groups.size());
+
+    // Step 2
+    map<vector<uint32_t>, uint8_t> class_of_signature;
+    array<int, 256> representative{};
+    for (int byte = 0; byte < 256; ++byte) {
+        vector<uint32_t> signature;
+        for (uint32_t q = 0; q < nfa.states.size(); ++q) {
+            if (nfa.states[q].consumes && nfa.states[q].bytes[byte]) signature.push_back(q);
+        }
+        auto [it, inserted] = class_of_signature.emplace(signature, static_cast<uint8_t>(class_of_signature.size()));
+        if (inserted) representative[it->second] = byte;
+        byte_class[byte] = it->second;
+    }
+    num_classes = static_cast<uint32_t>(class_of_signature.size());
+
+    // Step 3
+    vector<uint32_t> marks(nfa.states.size(), 0);
+    uint32_t generation = 0;
+    unordered_map<vector<uint32_t>, uint32_t, ListHash> ids;
+    vector<vector<uint32_t>> lists{{}};   // lists[0]: dead state
+    size_t max_entries = 0;
+
+    auto add_state = [&](const vector<Entry>& entries, vector<Operation>& ops) -> uint32_t {
+        vector<uint32_t> list;
+        for (uint32_t j = 0; j < entries.size(); ++j) {
+            list.push_back(entries[j].state);
+            for (uint32_t t = 0; t < num_tags; ++t) {
+                uint32_t source = entries[j].sources[t];
+                if (source == FROM_POSITION) {
+                    ops.push_back({j * num_tags + t, SET_POSITION});
+                } else if (source != UNSET && source != j) {
+                    ops.push_back({j * num_tags + t, source * num_tags + t});
+                }
+            }
+        }
+        if (list.empty()) return DEAD;
+        auto [it, inserted] = ids.emplace(list, static_cast<uint32_t>(lists.size()));
+        if (inserted) {
+            lists.push_back(move(list));
+            max_entries = max(max_entries, entries.size());
+            uint32_t final = NOT_FINAL;
+            for (uint32_t j = 0; j < entries.size() && final == NOT_FINAL; ++j) {
+                if (entries[j].state == nfa.accept) final = j;
+            }
+            final_entry.push_back(final);
+        }
+        return it->second;
+    };
+
+    final_entry.assign(1, NOT_FINAL);
+    vector<Entry> entries;
+    closure(nfa, nfa.start, vector<uint32_t>(num_tags, UNSET), marks, ++generation, entries);
+    start = add_state(entries, start_operations);
+
+    transitions.assign(num_classes, DEAD);
+    operation_begin.assign(num_classes + 1, 0);
+    vector<uint32_t> sources(num_tags);
+    for (size_t s = 1; s < lists.size(); ++s) {
+        if (lists.size() > max_states) {
+            *this = TaggedDFA();
+            return false;
+        }
+        for (uint32_t c = 0; c < num_classes; ++c) {
+            entries.clear();
+            ++generation;
+            const vector<uint32_t> current = lists[s];
+            for (uint32_t i = 0; i < current.size(); ++i) {
+                const TaggedNFA::State& state = nfa.states[current[i]];
+                if (!state.consumes || !state.bytes[representative[c]]) continue;
+                fill(sources.begin(), sources.end(), i);
+                closure(nfa, state.next, sources, marks, generation, entries);
+            }
+            transitions.push_back(add_state(entries, operations));
+            operation_begin.push_back(static_cast<uint32_t>(operations.size()));
+        }
+    }
+    num_registers = static_cast<uint32_t>(max_entries) * num_tags;
+    return true;
+}
+
+bool TaggedDFA::match(string_view input, vector<Capture>& captures) const {
+    captures.assign(num_groups() + 1, Capture());
+    if (final_entry.empty() || start == DEAD) return false;
+
+    vector<size_t> registers(num_registers, Capture::NO_POSITION);
+    vector<size_t> values;
+    for (const Operation& op : start_operations) registers[op.target] = 0;
+
+    uint32_t state = start;
+    for (size_t i = 0; i < input.size(); ++i) {
+        size_t t = static_cast<size_t>(state) * num_classes + byte_class[static_cast<unsigned char>(input[i])];
+        state = transitions[t];
+        if (state == DEAD) return false;
+
+        // Parallel assignment: read every source before writing
+        const Operation* first = operations.data() + operation_begin[t];
+        const Operation* last = operations.data() + operation_begin[t + 1];
+        values.clear();
+        for (const Operation* op = first; op != last; ++op) {
+            values.push_back(op->source == SET_POSITION ? i + 1 : registers[op->source]);
+        }
+        for (const Operation* op = first; op != last; ++op) registers[op->target] = values[op - first];
+    }
+
+    uint32_t final = final_entry[state];
+    if (final == NOT_FINAL) return false;
+    captures[0] = {0, input.size()};
+    for (size_t g = 1; g <= num_groups(); ++g) {
+        size_t begin = registers[final * num_tags + 2 * (g - 1)];
+        size_t end = registers[final * num_tags + 2 * (g - 1) + 1];
+        if (begin != Capture::NO_POSITION && end != Capture::NO_POSITION) captures[g] = {begin, end};
+    }
+    return true;
+}
+
+size_t TaggedDFA::size_in_bytes() const {
+    return sizeof(*this)
+         + transitions.size() * sizeof(uint32_t)
+         + operation_begin.size() * sizeof(uint32_t)
+         + (operations.size() + start_operations.size()) * sizeof(Operation)
+         + final_entry.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,71 @@
+#ifndef TAGGED_DFA_H
+#define TAGGED_DFA_H
+
+#include "parser.h"
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Tagged DFA for submatch extraction (Laurikari 2000, Trofimovich 2017)
+
+Every capture group k has two tags, "group k opens here" and "group k
+closes here", placed on ε-edges of a tagged NFA. A DFA state is an ordered
+list of NFA states (highest priority first); each entry owns one register
+per tag, holding the input position where that tag was last crossed. The
+transitions carry register operations ("copy register r to s" or "store
+the current position in s"), so one forward pass over the input yields
+both the match decision and all group boundaries.
+
+Disambiguation is leftmost-greedy (as in Perl and RE2): alternatives are
+preferred left to right, '*' prefers another iteration, and a group inside
+a star reports its last iteration. Groups are numbered by their '(' from 1;
+group 0 is the whole match.
+*/
+
+struct Capture {
+    static constexpr size_t NO_POSITION = SIZE_MAX;
+    size_t begin = NO_POSITION;
+    size_t end = NO_POSITION;
+    bool matched() const { return begin != NO_POSITION; }
+};
+
+class TaggedDFA {
+public:
+    // Returns false if more than max_states DFA states would be needed
+    bool build(const SyntaxTree& tree, size_t max_states = 1 << 16);
+
+    // Anchored: true if the whole input matches; captures[k] is group k
+    // (groups that did not take part are left unmatched)
+    bool match(std::string_view input, std::vector<Capture>& captures) const;
+
+    size_t num_groups() const { return num_tags / 2; }
+    uint32_t num_states() const { return static_cast<uint32_t>(final_entry.size()); }
+    size_t num_operations() const { return operations.size(); }
+    size_t size_in_bytes() const;
+
+private:
+    static constexpr uint32_t SET_POSITION = UINT32_MAX;   // source of "store the current position"
+    static constexpr uint32_t NOT_FINAL = UINT32_MAX;
+
+    struct Operation {
+        uint32_t target;   // register
+        uint32_t source;   // register or SET_POSITION
+    };
+
+    uint32_t start = 0;
+    uint32_t num_classes = 1;
+    uint32_t num_tags = 0;
+    uint32_t num_registers = 0;
+    std::array<uint8_t, 256> byte_class{};
+    std::vector<uint32_t> transitions;         // state * num_classes + class, 0 = dead
+    // Operations of transition t: [operation_begin[t], operation_begin[t + 1])
+    std::vector<uint32_t> operation_begin;
+    std::vector<Operation> operations;
+    std::vector<Operation> start_operations;   // applied at position 0
+    std::vector<uint32_t> final_entry;         // entry whose registers hold the result, or NOT_FINAL
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "tcp_reassembler.h"
+
+using namespace std;
+
+void TcpReassembler::add(const TcpSegment& segment) {
+    const bool syn = (segment.flags & TcpSegment::SYN) != 0;
+    auto [it, inserted] = stream_of.emplace(segment.tuple, streams.size());
+    if (!inserted && syn && streams[it->second].closed) {
+        // Port reuse: a new connection on a finished tuple
+        it->second = streams.size();
+        inserted = true;
+    }
+    if (inserted) {
+        streams.emplace_back();
+        streams.back().tuple = segment.tuple;
+    }
+    const size_t index = it->second;
+    Stream& stream = streams[index];
+
+    // The SYN takes one sequence number; data on a SYN (TCP Fast Open) follows it
+    uint32_t sequence = segment.sequence + (syn ? 1 : 0);
+    if (!stream.synced && (syn || !segment.payload.empty())) {
+        stream.synced = true;
+        stream.next_sequence = sequence;
+    }
+    if (segment.flags & (TcpSegment::FIN | TcpSegment::RST)) stream.closed = true;
+    if (segment.payload.empty()) return;
+
+    string_view data = segment.payload;
+    int32_t ahead = static_cast<int32_t>(sequence - stream.next_sequence);
+    if (ahead < 0) {
+        size_t seen = static_cast<size_t>(-static_cast<int64_t>(ahead));
+        if (seen >= data.size()) return;   // retransmission
+        data.remove_prefix(seen);
+        ahead = 0;
+    }
+    if (ahead == 0) {
+        deliver(index, data);
+        drain(index);
+        return;
+    }
+
+    uint64_t offset = stream.next_offset + static_cast<uint64_t>(ahead);
+    auto [slot, added] = stream.pending.emplace(offset, string());
+    if (!added && slot->second.size() >= data.size()) return;
+    stream.pending_bytes += data.size() - slot->second.size();
+    slot->second.assign(data.data(), data.size());
+    while (stream.pending_bytes > max_buffered) skip_hole(index);
+}
+
+void TcpReassembler::deliver(size_t index, string_view data) {
+    Stream& stream = streams[index];
+    handler(index, stream.tuple, stream.next_offset, data);
+    stream.next_offset += data.size();
+    stream.next_sequence += static_cast<uint32_t>(data.size());
+}
+
+// Hands over buffered segments that have become contiguous
+void TcpReassembler::drain(size_t index) {
+    Stream& stream = streams[index];
+    while (!stream.pending.empty() && stream.pending.begin()->first <= stream.next_offset) {
+        auto first = stream.pending.begin();
+        uint64_t offset = first->first;
+        string data = move(first->second);
+        stream.pending.erase(first);
+        stream.pending_bytes -= data.size();
+        if (offset + data.size() > stream.next_offset) {
+            deliver(index, string_view(data).substr(static_cast<size_t>(stream.next_offset - offset)));
+        }
+    }
+}
+
+// Gives up on the bytes before the first buffered segment
+void TcpReassembler::skip_hole(size_t index) {
+    Stream& stream = streams[index];
+    if (stream.pending.empty()) return;
+    uint64_t hole = stream.pending.begin()->first - stream.next_offset;
+    stream.next_offset += hole;
+    stream.next_sequence += static_cast<uint32_t>(hole);
+    drain(index);
+}
+
+void TcpReassembler::flush() {
+    for (size_t index = 0; index < streams.size(); ++index) {
+        while (!streams[index].pending.empty()) skip_hole(index);
+    }
+}
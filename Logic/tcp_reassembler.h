@@ -0,0 +1,65 @@
+#ifndef TCP_REASSEMBLER_H
+#define TCP_REASSEMBLER_H
+
+#include "packet_capture.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+TCP payload reassembly, one stream per direction
+
+Each direction of a connection is a stream, numbered in order of first
+appearance. Its payload is handed over in sequence order with its offset
+in the stream:
+- the sequence number is synced on the SYN, or on the first data segment
+  of a connection whose handshake was not captured;
+- retransmitted and overlapping bytes are dropped;
+- segments ahead of the next expected byte are buffered; once a stream
+  buffers more than max_buffered bytes, or at flush(), the missing bytes
+  are given up and delivery resumes after the hole. The offset then jumps
+  past the end of the previous data, which tells the handler about the gap.
+A SYN after a FIN or RST on the same tuple starts a new stream.
+*/
+class TcpReassembler {
+public:
+    using DataHandler = std::function<void(size_t stream, const FlowTuple& tuple, uint64_t offset, std::string_view data)>;
+
+    explicit TcpReassembler(DataHandler handler, size_t max_buffered = 1 << 20)
+        : handler(std::move(handler)), max_buffered(max_buffered) {}
+
+    void add(const TcpSegment& segment);
+    // End of capture: delivers everything still buffered, skipping holes
+    void flush();
+
+    size_t num_streams() const { return streams.size(); }
+    const FlowTuple& tuple(size_t stream) const { return streams[stream].tuple; }
+
+private:
+    struct Stream {
+        FlowTuple tuple;
+        bool synced = false;
+        bool closed = false;              // FIN or RST seen
+        uint32_t next_sequence = 0;
+        uint64_t next_offset = 0;         // stream offset of next_sequence
+        std::map<uint64_t, std::string> pending;   // out-of-order data by stream offset
+        size_t pending_bytes = 0;
+    };
+
+    DataHandler handler;
+    size_t max_buffered;
+    std::vector<Stream> streams;
+    std::unordered_map<FlowTuple, size_t, FlowTupleHash> stream_of;
+
+    void deliver(size_t index, std::string_view data);
+    void drain(size_t index);
+    void skip_hole(size_t index);
+};
+
+#endif
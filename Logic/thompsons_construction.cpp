@@ -1,5 +1,5 @@
 #include "thompsons_construction.h"
-#include "postfix.h"
+#include "parser.h"
 
 #include <iostream>
 #include <map>
@@ -7,6 +7,7 @@
 #include <stack>
 #include <memory>
 #include <vector>
+#include <atomic>
 using namespace std;
 
 // This file does
@@ -30,9 +31,7 @@ function implementations (like create_state() and build_nfa_from_syntax_tree())
 
 // already done:
 // 1. receive regex as input
-// 2. add explicit concatenation operators .
-// 3. convert the regex into postfix using the shunting-yard algorithm
-// 4. build syntax tree from postfix using a stack
+// 2. parse the regex into a syntax tree (single recursive-descent pass)
 
 // now I use trees and stack to build NFA from regexp
 
@@ -41,7 +40,8 @@ function implementations (like create_state() and build_nfa_from_syntax_tree())
 Step 5 - Construct NFA from Syntax Tree Using Thompson's Construction
 */
 // Global state ID counter
-int state_id_counter = 0;
+// atomic because separate branches of one regex may be built on several threads
+atomic<int> state_id_counter{0};
 
 // Function to create a new NFA state with a unique ID
 shared_ptr<NFAState> create_state() {
@@ -49,19 +49,34 @@ shared_ptr<NFAState> create_state() {
 }
 
 // Thompson's construction to build NFA from syntax tree
-NFA build_nfa_from_syntax_tree(const shared_ptr<TreeNode>& node) {
+NFA build_nfa_from_syntax_tree(const TreeNode* node) {
     if (!node) {
         return NFA();
     }
-    if (isalnum(node->value) || node->value == EPSILON) { // Base case: single symbol or ε
+    if (node->value == CHAR_CLASS) { // Base case: one transition per symbol of the class
+        NFA nfa;
+        nfa.start_state = create_state();
+        nfa.accept_state = create_state();
+        nfa.accept_state->is_accepting = true;
+
+        vector<char> symbols;
+        expand_char_class(*node->char_class, symbols);
+        for (char symbol : symbols) {
+            nfa.start_state->transitions[symbol].push_back(nfa.accept_state);
+        }
+        return nfa;
+    } else if (isalnum(node->value) || node->value == EPSILON) { // Base case: single symbol or ε
         NFA nfa;
         nfa.start_state = create_state();
         nfa.accept_state = create_state();
         
         nfa.accept_state->is_accepting = true;
 
-        char symbol = node->value;
-        nfa.start_state->transitions[symbol].push_back(nfa.accept_state);
+        if (node->value == EPSILON) {
+            nfa.start_state->epsilon.push_back(nfa.accept_state);
+        } else {
+            nfa.start_state->transitions[node->value].push_back(nfa.accept_state);
+        }
         return nfa;
     } else if (node->value == '*') { // Kleene star
         NFA sub_nfa = build_nfa_from_syntax_tree(node->left);
@@ -74,10 +89,10 @@ NFA build_nfa_from_syntax_tree(const shared_ptr<TreeNode>& node) {
         sub_nfa.accept_state->is_accepting = false;
 
         // ε-transitions for star operation
-        nfa.start_state->transitions[EPSILON].push_back(sub_nfa.start_state);
-        nfa.start_state->transitions[EPSILON].push_back(nfa.accept_state);
-        sub_nfa.accept_state->transitions[EPSILON].push_back(sub_nfa.start_state);
-        sub_nfa.accept_state->transitions[EPSILON].push_back(nfa.accept_state);
+        nfa.start_state->epsilon.push_back(sub_nfa.start_state);
+        nfa.start_state->epsilon.push_back(nfa.accept_state);
+        sub_nfa.accept_state->epsilon.push_back(sub_nfa.start_state);
+        sub_nfa.accept_state->epsilon.push_back(nfa.accept_state);
         return nfa;
     } else if (node->value == '.') { // Concatenation
         NFA left_nfa = build_nfa_from_syntax_tree(node->left);
@@ -87,7 +102,7 @@ NFA build_nfa_from_syntax_tree(const shared_ptr<TreeNode>& node) {
         left_nfa.accept_state->is_accepting = false;
 
         // connect left NFA's accept state to right NFA's start state via ε-transition
-        left_nfa.accept_state->transitions[EPSILON].push_back(right_nfa.start_state);
+        left_nfa.accept_state->epsilon.push_back(right_nfa.start_state);
 
         NFA nfa;
         nfa.start_state = left_nfa.start_state;
@@ -107,11 +122,11 @@ NFA build_nfa_from_syntax_tree(const shared_ptr<TreeNode>& node) {
         nfa.accept_state->is_accepting = true;
 
         // ε-transitions from new start state to both sub-NFAs
-        nfa.start_state->transitions[EPSILON].push_back(left_nfa.start_state);
-        nfa.start_state->transitions[EPSILON].push_back(right_nfa.start_state);
+        nfa.start_state->epsilon.push_back(left_nfa.start_state);
+        nfa.start_state->epsilon.push_back(right_nfa.start_state);
         // ε-transitions from both sub-NFAs' accept states to new accept state
-        left_nfa.accept_state->transitions[EPSILON].push_back(nfa.accept_state);
-        right_nfa.accept_state->transitions[EPSILON].push_back(nfa.accept_state);
+        left_nfa.accept_state->epsilon.push_back(nfa.accept_state);
+        right_nfa.accept_state->epsilon.push_back(nfa.accept_state);
         return nfa;
     }
     return NFA(); // should not reach here
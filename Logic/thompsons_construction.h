@@ -6,16 +6,18 @@
 #include <map>
 #include <string>
 
-// Forward declaration of TreeNode (so we don't need to include postfix_stack_method.h)
+// Forward declaration of TreeNode (so we don't need to include parser.h)
 struct TreeNode;
 
-// Use '\0' as epsilon
+// Leaf value of ε in the syntax tree. NFA ε-moves are kept in their own
+// list, so '\0' is an ordinary input byte in `transitions`.
 constexpr char EPSILON = '\0';
 
 // NFA State
 struct NFAState {
     int id;
     std::map<char, std::vector<std::shared_ptr<NFAState>>> transitions;
+    std::vector<std::shared_ptr<NFAState>> epsilon;   // ε-transitions
     bool is_accepting;
 
     NFAState(int state_id) : id(state_id), is_accepting(false) {}
@@ -31,6 +33,6 @@ struct NFA {
 
 // Functions
 std::shared_ptr<NFAState> create_state();
-NFA build_nfa_from_syntax_tree(const std::shared_ptr<TreeNode>& node);
+NFA build_nfa_from_syntax_tree(const TreeNode* node);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "token_automaton.h"
+
+using namespace std;
+
+// Definitions live here; the three supported widths are instantiated below
+
+template <typename Symbol>
+void TokenDFA<Symbol>::build(const TreeNode* root) {
+    build(build_symbolic_nfa(root, Traits::MAX_SYMBOL));
+}
+
+template <typename Symbol>
+void TokenDFA<Symbol>::build(SymbolicNFA nfa) {
+    *this = TokenDFA();
+
+    // Predicates beyond the width are clipped by compute_minterms; symbols
+    // no predicate mentions fall into a minterm that only leads to dead
+    nfa.max_symbol = Traits::MAX_SYMBOL;
+    SymbolicDFA dfa = minimize_symbolic_dfa(symbolic_nfa_to_dfa(nfa));
+
+    start_state = dfa.start;
+    num_columns = static_cast<uint32_t>(dfa.minterms.size());
+    transitions = move(dfa.transitions);
+    accepting = move(dfa.accepting);
+
+    if constexpr (Traits::DIRECT_LOOKUP) {
+        direct.resize(static_cast<size_t>(Traits::MAX_SYMBOL) + 1);
+        for (size_t i = 0; i < dfa.interval_starts.size(); ++i) {
+            size_t end = i + 1 < dfa.interval_starts.size() ? dfa.interval_starts[i + 1] : direct.size();
+            fill(direct.begin() + dfa.interval_starts[i], direct.begin() + end,
+                 static_cast<Column>(dfa.interval_minterms[i]));
+        }
+    } else {
+        interval_starts = move(dfa.interval_starts);
+        interval_columns.assign(dfa.interval_minterms.begin(), dfa.interval_minterms.end());
+    }
+}
+
+template <typename Symbol>
+bool TokenDFA<Symbol>::matches(const Symbol* symbols, size_t count) const {
+    if (accepting.empty()) return false;
+    uint32_t state = start_state;
+    for (size_t i = 0; i < count; ++i) {
+        state = next(state, symbols[i]);
+        if (state == DEAD_STATE) return false;
+    }
+    return accepting[state] != 0;
+}
+
+template <typename Symbol>
+size_t TokenDFA<Symbol>::count_match_ends(const Symbol* symbols, size_t count) const {
+    if (accepting.empty()) return 0;
+    uint32_t state = start_state;
+    size_t found = accepting[state];
+    for (size_t i = 0; i < count; ++i) {
+        state = next(state, symbols[i]);
+        if (state == DEAD_STATE) break;
+        found += accepting[state];
+    }
+    return found;
+}
+
+template <typename Symbol>
+size_t TokenDFA<Symbol>::size_in_bytes() const {
+    return sizeof(*this)
+         + direct.size() * sizeof(Column)
+         + interval_starts.size() * sizeof(uint32_t)
+         + interval_columns.size() * sizeof(Column)
+         + transitions.size() * sizeof(uint32_t)
+         + accepting.size();
+}
+
+template class TokenDFA<uint8_t>;
+template class TokenDFA<uint16_t>;
+template class TokenDFA<uint32_t>;
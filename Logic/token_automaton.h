@@ -0,0 +1,89 @@
+#ifndef TOKEN_AUTOMATON_H
+#define TOKEN_AUTOMATON_H
+
+#include "symbolic_automaton.h"
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Minimized DFA over a fixed-width symbol type: bytes (uint8_t), 16-bit
+tokens (uint16_t) or 32-bit token ids / code points (uint32_t).
+
+Determinization and minimization run on the symbolic core, which works on
+minterms and never on single symbols, so the same machinery serves every
+width. ε is a separate edge kind there, so every value of Symbol,
+including 0 (NUL), is an ordinary symbol.
+
+The symbol -> column lookup is chosen at compile time from the width:
+narrow alphabets use one array access, 32-bit symbols binary-search the
+minterm intervals.
+*/
+
+template <typename Symbol>
+struct SymbolTraits {
+    static_assert(std::is_unsigned<Symbol>::value && sizeof(Symbol) <= 4,
+                  "symbols are unsigned integers of at most 32 bits");
+
+    static constexpr uint32_t MAX_SYMBOL = std::numeric_limits<Symbol>::max();
+    static constexpr bool DIRECT_LOOKUP = sizeof(Symbol) <= 2;
+    // A direct table has at most 2^16 columns, so 16-bit column ids suffice
+    using Column = typename std::conditional<DIRECT_LOOKUP, uint16_t, uint32_t>::type;
+};
+
+template <typename Symbol>
+class TokenDFA {
+public:
+    using Traits = SymbolTraits<Symbol>;
+    using Column = typename Traits::Column;
+    static constexpr uint32_t DEAD_STATE = 0;
+
+    // Regex over Symbol: a letter or digit stands for its code, classes and
+    // \x escapes for ranges of codes (clipped to the width of Symbol)
+    void build(const TreeNode* root);
+    // Any symbolic NFA, e.g. one built over token ids with add_move
+    void build(SymbolicNFA nfa);
+
+    uint32_t start() const { return start_state; }
+    uint32_t next(uint32_t state, Symbol symbol) const {
+        return transitions[static_cast<size_t>(state) * num_columns + column_of(symbol)];
+    }
+    bool is_accepting(uint32_t state) const { return accepting[state] != 0; }
+
+    // Anchored: the whole sequence is in the language
+    bool matches(const Symbol* symbols, size_t count) const;
+    bool matches(const std::vector<Symbol>& symbols) const { return matches(symbols.data(), symbols.size()); }
+    // Number of prefixes of the sequence in the language
+    size_t count_match_ends(const Symbol* symbols, size_t count) const;
+
+    uint32_t num_states() const { return static_cast<uint32_t>(accepting.size()); }
+    uint32_t columns() const { return num_columns; }
+    size_t size_in_bytes() const;
+
+private:
+    uint32_t start_state = DEAD_STATE;
+    uint32_t num_columns = 1;
+    std::vector<Column> direct;              // DIRECT_LOOKUP: symbol -> column
+    std::vector<uint32_t> interval_starts;   // otherwise: sorted interval starts
+    std::vector<Column> interval_columns;
+    std::vector<uint32_t> transitions;       // state * num_columns + column
+    std::vector<uint8_t> accepting;
+
+    Column column_of(Symbol symbol) const {
+        if constexpr (Traits::DIRECT_LOOKUP) {
+            return direct[symbol];
+        } else {
+            auto it = std::upper_bound(interval_starts.begin(), interval_starts.end(), static_cast<uint32_t>(symbol));
+            return interval_columns[static_cast<size_t>(it - interval_starts.begin()) - 1];
+        }
+    }
+};
+
+extern template class TokenDFA<uint8_t>;
+extern template class TokenDFA<uint16_t>;
+extern template class TokenDFA<uint32_t>;
+
+#endif
@@ -0,0 +1,308 @@
+#include "tree_scanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define TREE_SCANNER_HAS_PREAD 1
+#else
+#include <fstream>
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Window read while looking for the '\n' that ends a chunk
+constexpr size_t SPLIT_WINDOW = 64 << 10;
+
+class InputFile {
+public:
+    explicit InputFile(const string& path) {
+#ifdef TREE_SCANNER_HAS_PREAD
+        fd = open(path.c_str(), O_RDONLY);
+#else
+        stream.open(path, ios::binary);
+#endif
+    }
+    ~InputFile() {
+#ifdef TREE_SCANNER_HAS_PREAD
+        if (fd >= 0) close(fd);
+#endif
+    }
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+#ifdef TREE_SCANNER_HAS_PREAD
+    bool is_open() const { return fd >= 0; }
+#else
+    bool is_open() const { return stream.is_open(); }
+#endif
+
+    // Reads up to `size` bytes at `offset`; returns the number read (short at
+    // the end of the file), or SIZE_MAX on an error
+    size_t read_at(uint64_t offset, char* out, size_t size) {
+        size_t done = 0;
+#ifdef TREE_SCANNER_HAS_PREAD
+        while (done < size) {
+            ssize_t n = pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+            if (n < 0) return SIZE_MAX;
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+        }
+#else
+        stream.clear();
+        stream.seekg(static_cast<streamoff>(offset));
+        stream.read(out, static_cast<streamsize>(size));
+        done = static_cast<size_t>(stream.gcount());
+        if (stream.bad()) return SIZE_MAX;
+#endif
+        return done;
+    }
+
+private:
+#ifdef TREE_SCANNER_HAS_PREAD
+    int fd = -1;
+#else
+    ifstream stream;
+#endif
+};
+
+// One unit of work: a whole file (chunk 0 of a file not split yet) or a chunk
+struct Task {
+    size_t file;
+    size_t chunk;
+    uint64_t begin;
+    uint64_t end;
+};
+
+class TaskDeque {
+public:
+    void push_back(const Task& task) {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back(task);
+    }
+    // Owner end
+    bool pop_back(Task& task) {
+        lock_guard<mutex> guard(lock);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+    // Thief end: the oldest task, which for a split file is its last chunk
+    bool steal(Task& task) {
+        lock_guard<mutex> guard(lock);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+private:
+    mutex lock;
+    deque<Task> tasks;
+};
+
+struct ChunkResult {
+    uint64_t begin = 0;
+    size_t lines = 0;
+    size_t matching_lines = 0;
+    bool failed = false;
+    vector<LineMatch> matches;     // chunk-relative line numbers, file offsets
+    vector<string> texts;
+};
+
+// Per-thread scratch, reused for every task the worker runs
+struct Scratch {
+    vector<char> buffer;
+};
+
+// Chunk bounds for [0, size): each chunk ends just after the first '\n' at
+// or after its nominal end (or at the end of the file). The last window read
+// is reused while the next search starts inside it.
+bool split_at_lines(InputFile& file, uint64_t size, size_t chunk_size, vector<char>& window,
+                    vector<pair<uint64_t, uint64_t>>& chunks) {
+    window.resize(SPLIT_WINDOW);
+    uint64_t window_begin = 0;
+    size_t window_size = 0;
+    uint64_t begin = 0;
+    while (begin < size) {
+        uint64_t end = size;
+        if (size - begin > chunk_size) {
+            uint64_t pos = begin + chunk_size - 1;
+            while (pos < size) {
+                if (pos < window_begin || pos >= window_begin + window_size) {
+                    window_begin = pos;
+                    window_size = file.read_at(pos, window.data(), SPLIT_WINDOW);
+                    if (window_size == SIZE_MAX) return false;
+                    if (window_size == 0) break;
+                }
+                const char* from = window.data() + (pos - window_begin);
+                size_t left = static_cast<size_t>(window_begin + window_size - pos);
+                const void* newline = memchr(from, '\n', left);
+                if (newline) {
+                    end = pos + static_cast<size_t>(static_cast<const char*>(newline) - from) + 1;
+                    break;
+                }
+                pos += left;
+            }
+        }
+        chunks.emplace_back(begin, end);
+        begin = end;
+    }
+    return true;
+}
+
+void scan_chunk(const LineScanner& scanner, const TreeScanOptions& options, InputFile& file,
+                const Task& task, Scratch& scratch, ChunkResult& out) {
+    out.begin = task.begin;
+    scratch.buffer.resize(static_cast<size_t>(task.end - task.begin));
+    size_t n = file.read_at(task.begin, scratch.buffer.data(), scratch.buffer.size());
+    if (n == SIZE_MAX) {
+        out.failed = true;
+        return;
+    }
+
+    vector<LineMatch>* matches = options.collect_matches ? &out.matches : nullptr;
+    LineStream stream(scanner);
+    stream.feed(string_view(scratch.buffer.data(), n), matches);
+    stream.finish(matches);
+    out.lines = stream.lines();
+    out.matching_lines = stream.matching_lines();
+    for (LineMatch& match : out.matches) {
+        if (options.collect_text) out.texts.emplace_back(scratch.buffer.data() + match.begin, match.end - match.begin);
+        match.begin += task.begin;
+        match.end += task.begin;
+    }
+}
+
+// Regular files under `path` (symlinks are not followed), sorted by path
+bool collect_files(const string& path, vector<pair<string, uint64_t>>& files) {
+    error_code ec;
+    fs::file_status status = fs::status(path, ec);
+    if (ec || !fs::exists(status)) return false;
+    if (fs::is_regular_file(status)) {
+        files.emplace_back(path, fs::file_size(path, ec));
+        return true;
+    }
+    if (!fs::is_directory(status)) return true;
+
+    fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        error_code entry_ec;
+        if (!fs::is_regular_file(it->symlink_status(entry_ec))) continue;
+        uint64_t size = it->file_size(entry_ec);
+        files.emplace_back(it->path().string(), entry_ec ? 0 : size);
+    }
+    sort(files.begin(), files.end());
+    return true;
+}
+
+} // namespace
+
+/*
+Tree scan
+Step 1 - Walk the tree, sort the files, deal them round-robin to the worker deques
+Step 2 - Workers (the calling thread is worker 0) pop their own deque, steal
+         from the others when it is empty, and stop once no task is pending
+         (a split adds its chunks to `pending` before pushing them)
+Step 3 - Merge the chunk results in file and chunk order
+*/
+bool TreeScanner::scan(const string& path, const TreeScanOptions& options, TreeScanResult& result) const {
+    result = TreeScanResult();
+    vector<pair<string, uint64_t>> files;
+    if (!collect_files(path, files)) return false;
+
+    // Step 1
+    unsigned num_threads = options.num_threads ? options.num_threads : max(1u, thread::hardware_concurrency());
+    size_t chunk_size = max<size_t>(options.chunk_size, 1);
+    vector<TaskDeque> queues(num_threads);
+    vector<vector<ChunkResult>> chunks(files.size(), vector<ChunkResult>(1));
+    for (size_t f = 0; f < files.size(); ++f) {
+        queues[f % num_threads].push_back({f, 0, 0, files[f].second});
+    }
+
+    // Step 2
+    atomic<size_t> pending{files.size()};
+    auto run = [&](size_t id, const Task& first, Scratch& scratch) {
+        Task task = first;
+        InputFile file(files[task.file].first);
+        if (!file.is_open()) {
+            chunks[task.file][task.chunk].failed = true;
+            return;
+        }
+        if (task.chunk == 0 && task.end > chunk_size) {
+            vector<pair<uint64_t, uint64_t>> bounds;
+            if (!split_at_lines(file, task.end, chunk_size, scratch.buffer, bounds)) {
+                chunks[task.file][0].failed = true;
+                return;
+            }
+            chunks[task.file].resize(bounds.size());
+            pending += bounds.size() - 1;
+            for (size_t c = bounds.size() - 1; c >= 1; --c) {
+                queues[id].push_back({task.file, c, bounds[c].first, bounds[c].second});
+            }
+            task.end = bounds[0].second;
+        }
+        scan_chunk(scanner, options, file, task, scratch, chunks[task.file][task.chunk]);
+    };
+    auto worker = [&](size_t id) {
+        Scratch scratch;
+        Task task;
+        while (true) {
+            bool found = queues[id].pop_back(task);
+            for (size_t k = 1; !found && k < num_threads; ++k) {
+                found = queues[(id + k) % num_threads].steal(task);
+            }
+            if (found) {
+                run(id, task, scratch);
+                --pending;
+            } else if (pending.load() == 0) {
+                return;
+            } else {
+                this_thread::yield();
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (size_t t = 1; t < num_threads; ++t) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    // Step 3
+    result.matching_lines.assign(files.size(), 0);
+    for (size_t f = 0; f < files.size(); ++f) {
+        result.files.push_back(move(files[f].first));
+        bool failed = any_of(chunks[f].begin(), chunks[f].end(), [](const ChunkResult& c) { return c.failed; });
+        if (failed) {
+            result.unreadable.push_back(result.files.back());
+            continue;
+        }
+        size_t lines_before = 0;
+        for (ChunkResult& chunk : chunks[f]) {
+            result.matching_lines[f] += chunk.matching_lines;
+            for (size_t m = 0; m < chunk.matches.size(); ++m) {
+                LineMatch line = chunk.matches[m];
+                line.line_number += lines_before;
+                result.matches.push_back({f, line, options.collect_text ? move(chunk.texts[m]) : string()});
+            }
+            lines_before += chunk.lines;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef TREE_SCANNER_H
+#define TREE_SCANNER_H
+
+#include "line_scanner.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Parallel line scanning of a directory tree (grep -r)
+
+The tree is walked once and its regular files sorted by path. Workers
+share one LineScanner and keep their read buffer and match list as
+per-thread scratch. Files are dealt round-robin to per-worker deques; a
+worker pops from the back of its own deque and, when it runs dry, steals
+from the front of the others. A file larger than chunk_size is split by
+the worker that pops it into chunks ending at '\n', which go to that
+worker's deque so idle workers can steal them.
+
+Each chunk writes its own result slot; the merge walks files in path
+order and chunks in file order, turning chunk-relative line numbers into
+file line numbers, so the output does not depend on the scheduling.
+*/
+
+struct TreeScanOptions {
+    unsigned num_threads = 0;          // 0: hardware concurrency
+    size_t chunk_size = 4 << 20;       // files above this are split
+    bool collect_matches = true;       // false: per-file counts only
+    bool collect_text = false;         // copy each matching line into its match
+};
+
+struct FileLineMatch {
+    size_t file;                       // index in TreeScanResult::files
+    LineMatch line;                    // offsets in the file
+    std::string text;                  // without '\n', if collect_text
+};
+
+struct TreeScanResult {
+    std::vector<std::string> files;            // regular files, sorted by path
+    std::vector<size_t> matching_lines;        // per file
+    std::vector<FileLineMatch> matches;        // by file, then by line
+    std::vector<std::string> unreadable;       // files that failed to read
+};
+
+class TreeScanner {
+public:
+    explicit TreeScanner(const LineScanner& scanner) : scanner(scanner) {}
+
+    // `path` may be a directory (walked recursively) or a single file.
+    // Returns false if it does not exist.
+    bool scan(const std::string& path, const TreeScanOptions& options, TreeScanResult& result) const;
+
+private:
+    const LineScanner& scanner;
+};
+
+#endif